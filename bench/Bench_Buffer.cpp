@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Bench_Common.h"
+#include "../dcAudioGraph/AudioBuffer.h"
+#include "../dcAudioGraph/AudioKernels.h"
+
+using namespace dc;
+
+DC_BENCHMARK(BufferKernels)
+{
+  // every set of kernels this machine can run, on one bus-sized channel
+  const size_t numSamples = 512;
+  std::vector<float> src(numSamples, 0.1f);
+  std::vector<float> dst(numSamples, 0.2f);
+  float result = 0.0f;
+
+  for (auto isa : {AudioKernels::Isa::Scalar, AudioKernels::Isa::Sse2, AudioKernels::Isa::Avx2,
+                   AudioKernels::Isa::Neon})
+  {
+    const auto* k = getAudioKernels(isa);
+    if (nullptr == k)
+    {
+      continue;
+    }
+
+    const std::string name = k->name;
+    bench::report("BufferKernels", name + ", add",
+                  bench::timeIt([&]() { k->add(dst.data(), src.data(), numSamples); }, 100000));
+    bench::report("BufferKernels", name + ", addWithGain",
+                  bench::timeIt([&]() { k->addWithGain(dst.data(), src.data(), 0.5f, numSamples); }, 100000));
+    bench::report("BufferKernels", name + ", addWithGainRamp",
+                  bench::timeIt([&]() { k->addWithGainRamp(dst.data(), src.data(), 0.5f, 0.001f, numSamples); },
+                                100000));
+    bench::report("BufferKernels", name + ", sumOfSquares",
+                  bench::timeIt([&]() { result += k->sumOfSquares(src.data(), numSamples); }, 100000));
+    bench::report("BufferKernels", name + ", peak",
+                  bench::timeIt([&]() { result += k->peak(src.data(), numSamples); }, 100000));
+  }
+
+  // keep the results alive
+  if (result < 0.0f)
+  {
+    bench::report("BufferKernels", "", result);
+  }
+}
+
+DC_BENCHMARK(BufferMix)
+{
+  // a stereo bus summing a bunch of sends, each with its own level
+  const size_t numSamples = 256;
+  const size_t numSends = 32;
+
+  std::vector<AudioBuffer> sends(numSends);
+  for (auto& s : sends)
+  {
+    s.resize(numSamples, 2);
+    s.fill(0.1f);
+  }
+  AudioBuffer bus(numSamples, 2);
+
+  const double ns = bench::timeIt([&]()
+                                  {
+                                    bus.zero();
+                                    for (size_t i = 0; i < numSends; ++i)
+                                    {
+                                      for (size_t cIdx = 0; cIdx < 2; ++cIdx)
+                                      {
+                                        bus.addFromWithGain(sends[i], cIdx, cIdx, 0.5f);
+                                      }
+                                    }
+                                  }, 20000);
+  bench::report("BufferMix", std::to_string(numSends) + " sends", ns);
+}
+
+DC_BENCHMARK(BufferInterleave)
+{
+  // what a host callback does on the way in and out
+  const size_t numSamples = 256;
+
+  for (size_t numChannels : {2, 8, 64})
+  {
+    AudioBuffer buffer(numSamples, numChannels);
+    buffer.fill(0.1f);
+    std::vector<float> interleaved(numSamples * numChannels, 0.2f);
+
+    const std::string channels = std::to_string(numChannels) + " channels";
+    bench::report("BufferInterleave", channels + ", from float",
+                  bench::timeIt([&]() { buffer.fromInterleaved(interleaved.data(), numSamples, numChannels, false); },
+                                10000));
+    bench::report("BufferInterleave", channels + ", to float",
+                  bench::timeIt([&]() { buffer.toInterleaved(interleaved.data(), numSamples, numChannels); }, 10000));
+
+    std::vector<int16_t> int16s(numSamples * numChannels, 1000);
+    bench::report("BufferInterleave", channels + ", from int16",
+                  bench::timeIt([&]()
+                                {
+                                  buffer.fromInterleaved(int16s.data(), AudioBuffer::SampleFormat::Int16, numSamples,
+                                                         numChannels, false);
+                                }, 10000));
+    bench::report("BufferInterleave", channels + ", to int16",
+                  bench::timeIt([&]()
+                                {
+                                  buffer.toInterleaved(int16s.data(), AudioBuffer::SampleFormat::Int16, numSamples,
+                                                       numChannels);
+                                }, 10000));
+
+    std::vector<uint8_t> int24s(numSamples * numChannels * 3, 0);
+    bench::report("BufferInterleave", channels + ", to int24",
+                  bench::timeIt([&]()
+                                {
+                                  buffer.toInterleaved(int24s.data(), AudioBuffer::SampleFormat::Int24, numSamples,
+                                                       numChannels);
+                                }, 10000));
+  }
+}
@@ -0,0 +1,32 @@
+/*
+ * A tiny benchmark harness, so the benchmarks don't need any dependencies.
+ * Run dcAudioGraph-bench with a name filter to only run some of them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace dc
+{
+namespace bench
+{
+// runs fn numIterations times, after a short warmup, and returns the average time per call in nanoseconds
+double timeIt(const std::function<void()>& fn, size_t numIterations);
+
+// prints a result line
+void report(const std::string& benchmark, const std::string& variant, double nsPerIteration);
+
+struct Registration
+{
+  Registration(const char* name, void (* fn)());
+};
+}
+}
+
+#define DC_BENCHMARK(name) \
+  static void name(); \
+  static dc::bench::Registration name##Registration(#name, name); \
+  static void name()
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bench_Common.h"
+#include "../dcAudioGraph/EventBuffer.h"
+#include "../dcAudioGraph/Graph.h"
+
+using namespace dc;
+
+DC_BENCHMARK(EventOrdering)
+{
+  // a block's worth of events spread over 512 samples, added one at a time or merged from two channels
+  const size_t blockSize = 512;
+  std::mt19937 rng(46);
+  std::uniform_int_distribution<size_t> offsetDist(0, blockSize - 1);
+
+  for (size_t numEvents : {10, 1000, 100000})
+  {
+    const size_t numIterations = numEvents < 100000 ? 1000000 / numEvents : 2;
+    std::vector<EventMessage> messages;
+    for (size_t i = 0; i < numEvents; ++i)
+    {
+      messages.emplace_back(EventMessage::Type::Trigger, offsetDist(rng));
+    }
+    std::vector<EventMessage> sorted = messages;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const EventMessage& a, const EventMessage& b)
+    {
+      return a.sampleOffset < b.sampleOffset;
+    });
+
+    // two sorted halves
+    EventBuffer::Channel a;
+    EventBuffer::Channel b;
+    for (size_t i = 0; i < numEvents; ++i)
+    {
+      (i % 2 ? a : b).insert(sorted[i]);
+    }
+
+    EventBuffer::Channel channel;
+    const std::string events = std::to_string(numEvents) + " events, ";
+
+    bench::report("EventOrdering", events + "insert in order", bench::timeIt([&]()
+    {
+      channel.clear();
+      for (auto& msg : sorted)
+      {
+        channel.insert(msg);
+      }
+    }, numIterations));
+
+    bench::report("EventOrdering", events + "insert out of order", bench::timeIt([&]()
+    {
+      channel.clear();
+      for (auto& msg : messages)
+      {
+        channel.insert(msg);
+      }
+    }, numIterations));
+
+    bench::report("EventOrdering", events + "merge", bench::timeIt([&]()
+    {
+      channel.clear();
+      channel.merge(a);
+      channel.merge(b);
+    }, numIterations));
+  }
+}
+
+DC_BENCHMARK(EventChannelRebuild)
+{
+  // modules with lots of event I/O, where every edit builds a fresh set of event channels
+  const size_t numModules = 200;
+  const size_t numEventIo = 32;
+
+  Graph g;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(64);
+    g.setSampleRate(44100);
+    g.setNumIo(Event | Input | Output, 1);
+
+    size_t prevId = g.getInputModule()->getId();
+    for (size_t i = 0; i < numModules; ++i)
+    {
+      auto m = std::make_unique<Module>();
+      m->setNumIo(Event | Input | Output, numEventIo);
+      const auto id = g.addModule(std::move(m));
+      g.addConnection({prevId, 0, id, 0, Connection::Type::Event});
+      prevId = id;
+    }
+    g.addConnection({prevId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Event});
+  }
+
+  const Connection c{g.getInputModule()->getId(), 0, g.getOutputModule()->getId(), 0, Connection::Type::Event};
+  bench::report("EventChannelRebuild", std::to_string(numModules) + " modules, " + std::to_string(numEventIo) +
+                                       " event I/O, per edit", bench::timeIt([&]()
+  {
+    g.addConnection(c);
+    g.removeConnection(c);
+    g.collectRetired();
+  }, 20) / 2);
+}
@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Bench_Common.h"
+#include "../dcAudioGraph/Gain.h"
+#include "../dcAudioGraph/Graph.h"
+#include "../dcAudioGraph/GraphTopology.h"
+
+using namespace dc;
+
+namespace
+{
+// a chain of modules that don't do anything, so all that's left to time is the graph's own overhead
+void makeEmptyChain(Graph& g, size_t numModules, size_t blockSize)
+{
+  ScopedEdit edit(g);
+  g.setBlockSize(blockSize);
+  g.setSampleRate(44100);
+  g.setNumIo(Audio | Input | Output, 1);
+
+  size_t prevId = g.getInputModule()->getId();
+  for (size_t i = 0; i < numModules; ++i)
+  {
+    auto m = std::make_unique<Module>();
+    m->setNumIo(Audio | Input | Output, 1);
+    const auto id = g.addModule(std::move(m));
+    g.addConnection({prevId, 0, id, 0, Connection::Type::Audio});
+    prevId = id;
+  }
+  g.addConnection({prevId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio});
+}
+}
+
+DC_BENCHMARK(GraphOverhead)
+{
+  const size_t blockSize = 16;
+
+  for (size_t numModules : {10, 100, 500})
+  {
+    Graph g;
+    makeEmptyChain(g, numModules, blockSize);
+
+    AudioBuffer buffer(blockSize, 1);
+    // not silent, so nothing gets skipped
+    buffer.fill(0.1f);
+    EventBuffer events;
+
+    const double ns = bench::timeIt([&]() { g.process(buffer, events); }, 20000);
+    bench::report("GraphOverhead", std::to_string(numModules) + " modules, per block", ns);
+  }
+}
+
+DC_BENCHMARK(GraphConnections)
+{
+  // lots of connections between a few wide modules, with a mix of audio and events
+  const size_t numChannels = 32;
+  const size_t numModules = 64;
+
+  for (size_t blockSize : {16, 64, 256})
+  {
+    Graph g;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Input | Output, numChannels);
+      g.setNumIo(Event | Input | Output, 1);
+
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < numModules; ++i)
+      {
+        auto m = std::make_unique<Module>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        m->setNumIo(Event | Input | Output, 1);
+        const auto id = g.addModule(std::move(m));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        g.addConnection({prevId, 0, id, 0, Connection::Type::Event});
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+    }
+
+    AudioBuffer buffer(blockSize, numChannels);
+    // not silent, so nothing gets skipped
+    buffer.fill(0.1f);
+    EventBuffer events;
+
+    const double ns = bench::timeIt([&]() { g.process(buffer, events); }, 5000);
+    bench::report("GraphConnections", std::to_string(g.getNumConnections()) + " connections, block size "
+                                      + std::to_string(blockSize), ns);
+  }
+}
+
+DC_BENCHMARK(GraphBufferPool)
+{
+  // a long chain of stereo modules, where a buffer per module doesn't fit in cache
+  const size_t numChannels = 2;
+  const size_t blockSize = 256;
+
+  for (size_t numModules : {100, 1000, 4000})
+  {
+    Graph g;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Input | Output, numChannels);
+
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < numModules; ++i)
+      {
+        auto m = std::make_unique<Module>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        const auto id = g.addModule(std::move(m));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+    }
+
+    AudioBuffer buffer(blockSize, numChannels);
+    // not silent, so nothing gets skipped
+    buffer.fill(0.1f);
+    EventBuffer events;
+
+    const double ns = bench::timeIt([&]() { g.process(buffer, events); }, 2000);
+    bench::report("GraphBufferPool", std::to_string(numModules) + " modules, "
+                                     + std::to_string(g.getPooledAudioMemory() / 1024) + "k pooled of "
+                                     + std::to_string(g.getUnpooledAudioMemory() / 1024) + "k", ns);
+  }
+}
+
+DC_BENCHMARK(GraphIdle)
+{
+  // lots of voices, each a short chain of gains, all mixed to the output
+  const size_t numChannels = 2;
+  const size_t blockSize = 64;
+  const size_t numVoices = 128;
+  const size_t chainLength = 2;
+
+  Graph g;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(blockSize);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, numChannels);
+
+    for (size_t v = 0; v < numVoices; ++v)
+    {
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < chainLength; ++i)
+      {
+        auto m = std::make_unique<Gain>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        const auto id = g.addModule(std::move(m));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+    }
+  }
+
+  AudioBuffer buffer(blockSize, numChannels);
+  EventBuffer events;
+
+  for (bool silent : {false, true})
+  {
+    const double ns = bench::timeIt([&]()
+                                    {
+                                      if (silent)
+                                      {
+                                        buffer.zero();
+                                      }
+                                      else
+                                      {
+                                        buffer.fill(0.1f);
+                                      }
+                                      g.process(buffer, events);
+                                    }, 500);
+    bench::report("GraphIdle", std::to_string(numVoices) + " voices, " + (silent ? "silent" : "playing"), ns);
+  }
+}
+
+DC_BENCHMARK(GraphDeadBranches)
+{
+  // a short chain to the output, next to lots of patches that aren't connected to anything yet,
+  // like a preset with most of its voices unplugged
+  const size_t numChannels = 2;
+  const size_t blockSize = 64;
+  const size_t chainLength = 8;
+
+  for (size_t numDead : {0, 500, 2000})
+  {
+    Graph g;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Input | Output, numChannels);
+
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < chainLength; ++i)
+      {
+        auto m = std::make_unique<Gain>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        const auto id = g.addModule(std::move(m));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+
+      // the dead ones hang off the input, so they'd have sound to work on
+      for (size_t i = 0; i < numDead; ++i)
+      {
+        auto m = std::make_unique<Gain>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        const auto id = g.addModule(std::move(m));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({g.getInputModule()->getId(), cIdx, id, cIdx, Connection::Type::Audio});
+        }
+      }
+    }
+
+    AudioBuffer buffer(blockSize, numChannels);
+    EventBuffer events;
+
+    const double ns = bench::timeIt([&]()
+                                    {
+                                      buffer.fill(0.1f);
+                                      g.process(buffer, events);
+                                    }, 500);
+    bench::report("GraphDeadBranches", std::to_string(numDead) + " dead modules", ns);
+  }
+}
+
+DC_BENCHMARK(GainProcess)
+{
+  // a chain of gains, with the gain held steady or moving every block
+  const size_t blockSize = 256;
+  const size_t chainLength = 8;
+
+  for (size_t numChannels : {1, 2, 8, 64})
+  {
+    Graph g;
+    std::vector<Module*> gains;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Input | Output, numChannels);
+
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < chainLength; ++i)
+      {
+        auto m = std::make_unique<Gain>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        const auto id = g.addModule(std::move(m));
+        gains.push_back(g.getModuleById(id));
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+    }
+
+    AudioBuffer buffer(blockSize, numChannels);
+    EventBuffer events;
+
+    for (bool moving : {false, true})
+    {
+      float value = 0.8f;
+      for (auto* m : gains)
+      {
+        m->getParam(0)->setNormalized(value);
+      }
+
+      const double ns = bench::timeIt([&]()
+                                      {
+                                        if (moving)
+                                        {
+                                          value = value > 0.75f ? 0.7f : 0.8f;
+                                          for (auto* m : gains)
+                                          {
+                                            m->getParam(0)->setNormalized(value);
+                                          }
+                                        }
+                                        buffer.fill(0.1f);
+                                        g.process(buffer, events);
+                                      }, 2000);
+      bench::report("GainProcess", std::to_string(numChannels) + " channels, " + (moving ? "moving" : "steady"),
+                    ns / chainLength);
+    }
+  }
+}
+
+DC_BENCHMARK(GainControlEvents)
+{
+  // gains modulated by a control event every 16 samples: small blocks with one event each,
+  // or big blocks with sample-accurate control inputs
+  const size_t numSamples = 512;
+  const size_t eventSpacing = 16;
+  const size_t numChannels = 2;
+  const size_t chainLength = 8;
+
+  for (size_t blockSize : {eventSpacing, numSamples})
+  {
+    Graph g;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Input | Output, numChannels);
+      g.setNumIo(Event | Input, 1);
+
+      size_t prevId = g.getInputModule()->getId();
+      for (size_t i = 0; i < chainLength; ++i)
+      {
+        auto m = std::make_unique<Gain>();
+        m->setNumIo(Audio | Input | Output, numChannels);
+        m->getParam(0)->setSampleAccurate(blockSize > eventSpacing);
+        const auto id = g.addModule(std::move(m));
+        g.addConnection({g.getInputModule()->getId(), 0, id, 0, Connection::Type::Event});
+        for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+        {
+          g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio});
+        }
+        prevId = id;
+      }
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+      }
+    }
+
+    AudioBuffer buffer(blockSize, numChannels);
+    EventBuffer events;
+    events.setNumChannels(1);
+    float value = 0.0f;
+
+    const double ns = bench::timeIt([&]()
+                                    {
+                                      for (size_t offset = 0; offset < numSamples; offset += blockSize)
+                                      {
+                                        events.clear();
+                                        for (size_t e = 0; e < blockSize; e += eventSpacing)
+                                        {
+                                          EventMessage msg(EventMessage::Type::Float, e + eventSpacing - 1);
+                                          value = value > 0.5f ? 0.1f : 0.9f;
+                                          msg.floatParam.value = value;
+                                          events.insert(msg, 0);
+                                        }
+                                        buffer.fill(0.1f);
+                                        g.process(buffer, events);
+                                      }
+                                    }, 2000);
+    bench::report("GainControlEvents", std::to_string(blockSize) + " sample blocks, per " +
+                                       std::to_string(numSamples) + " samples", ns);
+  }
+}
+
+DC_BENCHMARK(GraphLookup)
+{
+  // finding modules by id, and taking them out and putting them back, in graphs of different sizes
+  for (size_t numModules : {100, 1000, 10000})
+  {
+    Graph g;
+    std::vector<size_t> ids;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(16);
+      g.setSampleRate(44100);
+      for (size_t i = 0; i < numModules; ++i)
+      {
+        ids.push_back(g.addModule(std::make_unique<Module>()));
+      }
+    }
+
+    std::mt19937 rng(47);
+    std::vector<size_t> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    const std::string modules = std::to_string(numModules) + " modules, ";
+
+    size_t found = 0;
+    const double lookupNs = bench::timeIt([&]()
+                                          {
+                                            for (auto id : shuffled)
+                                            {
+                                              found += nullptr != g.getModuleById(id) ? 1 : 0;
+                                            }
+                                          }, 100000 / numModules + 1);
+    bench::report("GraphLookup", modules + "getModuleById", lookupNs / numModules);
+
+    // in an edit, so the graph only rebuilds once at the end
+    const size_t numToRemove = std::min<size_t>(numModules, 100);
+    const double removeNs = bench::timeIt([&]()
+                                          {
+                                            ScopedEdit edit(g);
+                                            for (size_t i = 0; i < numToRemove; ++i)
+                                            {
+                                              g.removeModuleById(shuffled[i]);
+                                            }
+                                            for (size_t i = 0; i < numToRemove; ++i)
+                                            {
+                                              g.addModule(std::make_unique<Module>(), shuffled[i]);
+                                            }
+                                          }, 20);
+    bench::report("GraphLookup", modules + "remove and add back, per module", removeNs / numToRemove);
+  }
+}
+
+DC_BENCHMARK(GraphDisconnect)
+{
+  // a module fed by 64 others along a chain, disconnected, then connected back up in one edit
+  const size_t numConnections = 64;
+
+  for (size_t numModules : {100, 1000})
+  {
+    Graph g;
+    makeEmptyChain(g, numModules, 16);
+
+    auto hub = std::make_unique<Module>();
+    hub->setNumIo(Audio | Input, numConnections);
+    hub->setNumIo(Audio | Output, 1);
+    const auto hubId = g.addModule(std::move(hub));
+    std::vector<Connection> connections;
+    for (size_t i = 0; i < numConnections; ++i)
+    {
+      connections.push_back({g.getModuleAt(i * numModules / numConnections)->getId(), 0, hubId, i,
+                             Connection::Type::Audio});
+    }
+    connections.push_back({hubId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio});
+    auto reconnect = [&]()
+    {
+      ScopedEdit edit(g);
+      for (auto& c : connections)
+      {
+        g.addConnection(c);
+      }
+    };
+    reconnect();
+
+    const double ns = bench::timeIt([&]()
+                                    {
+                                      g.disconnectModule(hubId);
+                                      reconnect();
+                                    }, 20);
+    bench::report("GraphDisconnect", std::to_string(numModules) + " modules, disconnect and reconnect", ns);
+  }
+}
+
+DC_BENCHMARK(GraphTopologyEdits)
+{
+  // Adding and removing a short-span edge in random DAGs of different sizes.
+  // Only the nodes between the edge's ends get reordered, so this should stay flat as the graph grows.
+  for (size_t numNodes : {1000, 10000, 100000})
+  {
+    std::mt19937 rng(5678);
+    GraphTopology t;
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+      t.addNode(i);
+    }
+    std::uniform_int_distribution<size_t> rankDist(0, numNodes - 9);
+    std::uniform_int_distribution<size_t> spanDist(1, 8);
+    for (size_t i = 0; i < numNodes * 2; ++i)
+    {
+      const size_t from = rankDist(rng);
+      t.addEdge(from, from + spanDist(rng));
+    }
+
+    const double ns = bench::timeIt([&]()
+                                    {
+                                      const size_t from = rankDist(rng);
+                                      t.addEdge(from, from + 8);
+                                      t.removeEdge(from, from + 8);
+                                    }, 20000);
+    bench::report("GraphTopologyEdits", std::to_string(numNodes) + " nodes, add and remove an edge", ns);
+  }
+}
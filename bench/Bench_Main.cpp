@@ -0,0 +1,61 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "Bench_Common.h"
+
+namespace
+{
+struct Benchmark
+{
+  const char* name;
+  void (* fn)();
+};
+
+std::vector<Benchmark>& getBenchmarks()
+{
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+}
+
+dc::bench::Registration::Registration(const char* name, void (* fn)())
+{
+  getBenchmarks().push_back({name, fn});
+}
+
+double dc::bench::timeIt(const std::function<void()>& fn, size_t numIterations)
+{
+  const size_t numWarmup = numIterations / 10 + 1;
+  for (size_t i = 0; i < numWarmup; ++i)
+  {
+    fn();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < numIterations; ++i)
+  {
+    fn();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / numIterations;
+}
+
+void dc::bench::report(const std::string& benchmark, const std::string& variant, double nsPerIteration)
+{
+  printf("%-32s %-40s %14.1f ns\n", benchmark.c_str(), variant.c_str(), nsPerIteration);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+  const char* filter = argc > 1 ? argv[1] : nullptr;
+  for (auto& b : getBenchmarks())
+  {
+    if (nullptr == filter || nullptr != strstr(b.name, filter))
+    {
+      b.fn();
+    }
+  }
+  return 0;
+}
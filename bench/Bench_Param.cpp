@@ -0,0 +1,121 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include "Bench_Common.h"
+#include "../dcAudioGraph/ModuleParam.h"
+
+using namespace dc;
+
+namespace
+{
+float getNormalizedSquared(float rawValue, float min, float max)
+{
+  const float pct = (rawValue - min) / (max - min);
+  return pct * pct;
+}
+
+float getRawSquared(float normalizedValue, float min, float max)
+{
+  return min + (max - min) * std::sqrt(normalizedValue);
+}
+
+float getRawGain(float normalizedValue, float min, float max)
+{
+  // the same curve as Gain
+  normalizedValue = std::exp(std::log(normalizedValue) / 2.0f);
+  return min + (max - min) * normalizedValue;
+}
+
+float dbToLin(float db)
+{
+  return std::pow(10.0f, db / 20.0f);
+}
+}
+
+DC_BENCHMARK(ParamSmoothing)
+{
+  // a block of a param that's moving, a sample at a time and all at once
+  const size_t blockSize = 512;
+  std::vector<float> values(blockSize);
+  float result = 0.0f;
+
+  std::vector<ModuleParam> params = {
+    ModuleParam("linear", "", ParamRange(0.0f, 1.0f, 0.0f)),
+    ModuleParam("linear, control input", "", ParamRange(0.0f, 1.0f, 0.0f), false, 0),
+    ModuleParam("curved, control input", "", ParamRange(-70.0f, 0.0f, 0.0f, getNormalizedSquared, getRawSquared),
+                false, 0)
+  };
+
+  for (auto& param : params)
+  {
+    float normalized = 0.0f;
+    auto nextBlock = [&]()
+    {
+      normalized = normalized > 0.5f ? 0.1f : 0.9f;
+      param.setNormalized(normalized);
+      param.setControlInput(normalized);
+      param.updateSmoothing(blockSize);
+    };
+
+    bench::report("ParamSmoothing", param.getId() + ", per sample", bench::timeIt([&]()
+    {
+      nextBlock();
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        values[i] = param.getSmoothedRaw(i);
+      }
+      result += values[blockSize - 1];
+    }, 20000));
+
+    bench::report("ParamSmoothing", param.getId() + ", block", bench::timeIt([&]()
+    {
+      nextBlock();
+      param.getSmoothedRaw(values.data(), blockSize);
+      result += values[blockSize - 1];
+    }, 20000));
+  }
+
+  // keep the results alive
+  if (result == 0.12345f)
+  {
+    bench::report("ParamSmoothing", "", result);
+  }
+}
+
+DC_BENCHMARK(ParamTables)
+{
+  // a block of a gain curve, from normalized values to linear gain, calling libm for each value or from tables
+  const size_t blockSize = 512;
+  std::vector<float> normalized(blockSize);
+  for (size_t i = 0; i < blockSize; ++i)
+  {
+    normalized[i] = static_cast<float>(i) / blockSize;
+  }
+  std::vector<float> values(blockSize);
+  float result = 0.0f;
+
+  ParamRange range(-70.0f, 0.0f, 0.0f, getNormalizedSquared, getRawGain);
+  bench::report("ParamTables", "libm", bench::timeIt([&]()
+  {
+    range.getRaw(normalized.data(), values.data(), blockSize);
+    for (auto& v : values)
+    {
+      v = dbToLin(v);
+    }
+    result += values[blockSize - 1];
+  }, 20000));
+
+  range.buildTables(ParamRange::DEFAULT_TABLE_SIZE, dbToLin);
+  bench::report("ParamTables", "tables", bench::timeIt([&]()
+  {
+    range.getRaw(normalized.data(), values.data(), blockSize);
+    range.getValue(values.data(), values.data(), blockSize);
+    result += values[blockSize - 1];
+  }, 20000));
+
+  // keep the results alive
+  if (result == 0.12345f)
+  {
+    bench::report("ParamTables", "", result);
+  }
+}
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bench_Common.h"
+#include "../dcAudioGraph/MessageQueue.h"
+#include "../dcAudioGraph/MultiProducerMessageQueue.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace dc;
+
+namespace
+{
+// keep a thread on one core, so the numbers are about the queue and not the scheduler
+void pinToCore(std::thread& thread, unsigned core)
+{
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(core % std::thread::hardware_concurrency(), &cpus);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+  (void)thread;
+  (void)core;
+#endif
+}
+
+struct Message
+{
+  size_t index;
+  float value;
+};
+}
+
+DC_BENCHMARK(MessageQueueThroughput)
+{
+  // one thread pushing and another popping as fast as they can, one message at a time or in batches
+  const size_t numMessages = 10000000;
+
+  for (size_t batchSize : {1, 16, 256})
+  {
+    MessageQueue<Message> q(1024);
+    size_t received = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread consumer([&]()
+                         {
+                           Message batch[256];
+                           while (received < numMessages)
+                           {
+                             const size_t numPopped = q.popBatch(batch, batchSize);
+                             received += numPopped;
+                             if (numPopped == 0)
+                             {
+                               std::this_thread::yield();
+                             }
+                           }
+                         });
+    std::thread producer([&]()
+                         {
+                           Message batch[256];
+                           size_t sent = 0;
+                           while (sent < numMessages)
+                           {
+                             size_t numInBatch = 0;
+                             for (; numInBatch < batchSize && sent + numInBatch < numMessages; ++numInBatch)
+                             {
+                               batch[numInBatch] = {sent + numInBatch, 0.5f};
+                             }
+                             const size_t numPushed = q.pushBatch(batch, numInBatch);
+                             sent += numPushed;
+                             if (numPushed == 0)
+                             {
+                               std::this_thread::yield();
+                             }
+                           }
+                         });
+    pinToCore(consumer, 0);
+    pinToCore(producer, 1);
+    producer.join();
+    consumer.join();
+
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    bench::report("MessageQueueThroughput", "batches of " + std::to_string(batchSize) + ", per message",
+                  ns / numMessages);
+  }
+}
+
+DC_BENCHMARK(MultiProducerThroughput)
+{
+  // several threads pushing one message at a time, and one popping
+  const size_t numMessages = 4000000;
+
+  for (size_t numProducers : {1, 2, 4})
+  {
+    MultiProducerMessageQueue<Message> q(1024);
+    const size_t numPerProducer = numMessages / numProducers;
+    size_t received = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread consumer([&]()
+                         {
+                           Message batch[64];
+                           while (received < numPerProducer * numProducers)
+                           {
+                             const size_t numPopped = q.popBatch(batch, 64);
+                             received += numPopped;
+                             if (numPopped == 0)
+                             {
+                               std::this_thread::yield();
+                             }
+                           }
+                         });
+    pinToCore(consumer, 0);
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < numProducers; ++p)
+    {
+      producers.emplace_back([&]()
+                             {
+                               for (size_t i = 0; i < numPerProducer;)
+                               {
+                                 if (q.push({i, 0.5f}))
+                                 {
+                                   ++i;
+                                 }
+                                 else
+                                 {
+                                   std::this_thread::yield();
+                                 }
+                               }
+                             });
+      pinToCore(producers.back(), static_cast<unsigned>(p + 1));
+    }
+    for (auto& producer : producers)
+    {
+      producer.join();
+    }
+    consumer.join();
+
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    bench::report("MultiProducerThroughput", std::to_string(numProducers) + " producers, per message",
+                  ns / (numPerProducer * numProducers));
+  }
+}
@@ -1,7 +1,98 @@
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include "AudioBuffer.h"
+#include "AudioKernels.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+float* allocateAligned(size_t numFloats)
+{
+#ifdef _WIN32
+  return static_cast<float*>(_aligned_malloc(numFloats * sizeof(float), dc::AudioBuffer::ALIGNMENT));
+#else
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, dc::AudioBuffer::ALIGNMENT, numFloats * sizeof(float)) != 0)
+  {
+    return nullptr;
+  }
+  return static_cast<float*>(ptr);
+#endif
+}
+
+void freeAligned(float* ptr)
+{
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+// conversions to and from fixed point go through a block of floats on the stack
+const size_t CONVERSION_BLOCK_SIZE = 1024;
+
+size_t getSampleSize(dc::AudioBuffer::SampleFormat format)
+{
+  switch (format)
+  {
+    case dc::AudioBuffer::SampleFormat::Int16:
+      return 2;
+    case dc::AudioBuffer::SampleFormat::Int24:
+      return 3;
+    case dc::AudioBuffer::SampleFormat::Int32:
+      return 4;
+  }
+  return 0;
+}
+
+void toFloat(const dc::AudioKernels& kernels, float* dst, const uint8_t* src, dc::AudioBuffer::SampleFormat format,
+             size_t numSamples)
+{
+  switch (format)
+  {
+    case dc::AudioBuffer::SampleFormat::Int16:
+      kernels.int16ToFloat(dst, reinterpret_cast<const int16_t*>(src), numSamples);
+      break;
+    case dc::AudioBuffer::SampleFormat::Int24:
+      kernels.int24ToFloat(dst, src, numSamples);
+      break;
+    case dc::AudioBuffer::SampleFormat::Int32:
+      kernels.int32ToFloat(dst, reinterpret_cast<const int32_t*>(src), numSamples);
+      break;
+  }
+}
+
+void fromFloat(const dc::AudioKernels& kernels, uint8_t* dst, const float* src, dc::AudioBuffer::SampleFormat format,
+               size_t numSamples)
+{
+  switch (format)
+  {
+    case dc::AudioBuffer::SampleFormat::Int16:
+      kernels.floatToInt16(reinterpret_cast<int16_t*>(dst), src, numSamples);
+      break;
+    case dc::AudioBuffer::SampleFormat::Int24:
+      kernels.floatToInt24(dst, src, numSamples);
+      break;
+    case dc::AudioBuffer::SampleFormat::Int32:
+      kernels.floatToInt32(reinterpret_cast<int32_t*>(dst), src, numSamples);
+      break;
+  }
+}
+}
+
+const size_t dc::AudioBuffer::ALIGNMENT;
+
+size_t dc::AudioBuffer::getPaddedStride(size_t numSamples)
+{
+  const size_t samplesPerLine = ALIGNMENT / sizeof(float);
+  return (numSamples + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+}
 
 dc::AudioBuffer::AudioBuffer(size_t numSamples, size_t numChannels)
 {
@@ -22,9 +113,52 @@ dc::AudioBuffer& dc::AudioBuffer::operator=(const AudioBuffer& other)
   return *this;
 }
 
+dc::AudioBuffer::AudioBuffer(AudioBuffer&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+dc::AudioBuffer& dc::AudioBuffer::operator=(AudioBuffer&& other) noexcept
+{
+  if (this != &other)
+  {
+    releaseData();
+    _data = other._data;
+    _numSamples = other._numSamples;
+    _numChannels = other._numChannels;
+    _stride = other._stride;
+    _allocatedSize = other._allocatedSize;
+    _ownsData = other._ownsData;
+
+    // the flags stay where they are, even if they're other's own
+    _silent = other._silent;
+    _ownSilenceFlags = std::move(other._ownSilenceFlags);
+    _numOwnSilenceFlags = other._numOwnSilenceFlags;
+
+    other._data = nullptr;
+    other._numSamples = 0;
+    other._numChannels = 0;
+    other._stride = 0;
+    other._allocatedSize = 0;
+    other._ownsData = true;
+    other._silent = nullptr;
+    other._numOwnSilenceFlags = 0;
+  }
+  return *this;
+}
+
 dc::AudioBuffer::~AudioBuffer()
 {
-  free(_data);
+  releaseData();
+}
+
+void dc::AudioBuffer::releaseData()
+{
+  if (_ownsData)
+  {
+    freeAligned(_data);
+  }
+  _data = nullptr;
 }
 
 void dc::AudioBuffer::resize(size_t numSamples, size_t numChannels)
@@ -35,55 +169,124 @@ void dc::AudioBuffer::resize(size_t numSamples, size_t numChannels)
     return;
   }
 
+  // whatever was in the buffer is garbage now
+  useOwnSilenceFlags(numChannels);
+
   // if we're downsizing or keeping the same total size, just change the counts
-  if (numSamples * numChannels <= _allocatedSize)
+  const size_t stride = getPaddedStride(numSamples);
+  if (stride * numChannels <= _allocatedSize)
   {
     _numSamples = numSamples;
     _numChannels = numChannels;
+    _stride = stride;
     return;
   }
 
   // free the old data
-  free(_data);
+  releaseData();
+  _ownsData = true;
 
   // set the new size
   _numSamples = numSamples;
   _numChannels = numChannels;
+  _stride = stride;
 
   // allocate the new data
-  _allocatedSize = _numSamples * _numChannels;
-  _data = static_cast<float*>(malloc(_allocatedSize * sizeof(float)));
+  _allocatedSize = _stride * _numChannels;
+  _data = allocateAligned(_allocatedSize);
 }
 
-void dc::AudioBuffer::fill(float value)
+void dc::AudioBuffer::setExternalData(float* data, bool* silenceFlags, size_t numSamples, size_t numChannels,
+                                      size_t channelStride)
 {
-  for (size_t i = 0; i < _allocatedSize; ++i)
+  releaseData();
+  _ownsData = false;
+
+  if (nullptr != silenceFlags)
   {
-    _data[i] = value;
+    _silent = silenceFlags;
   }
+  else
+  {
+    useOwnSilenceFlags(numChannels);
+  }
+
+  _data = data;
+  _numSamples = numSamples;
+  _numChannels = numChannels;
+  _stride = channelStride;
+  _allocatedSize = channelStride * numChannels;
 }
 
-void dc::AudioBuffer::fill(size_t channel, float value)
+void dc::AudioBuffer::useOwnSilenceFlags(size_t numChannels)
 {
-  if (float* start = getChannelPointer(channel))
+  if (numChannels > _numOwnSilenceFlags)
   {
-    for (size_t i = 0; i < _numSamples; ++i)
+    _ownSilenceFlags.reset(new bool[numChannels]);
+    _numOwnSilenceFlags = numChannels;
+  }
+  _silent = _ownSilenceFlags.get();
+
+  for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+  {
+    _silent[cIdx] = false;
+  }
+}
+
+bool dc::AudioBuffer::isSilent(size_t channel) const
+{
+  return channel < _numChannels && _silent[channel];
+}
+
+bool dc::AudioBuffer::isSilent() const
+{
+  for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
+  {
+    if (!_silent[cIdx])
     {
-      start[i] = value;
+      return false;
     }
   }
+  return true;
+}
+
+void dc::AudioBuffer::fill(float value)
+{
+  for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
+  {
+    fill(cIdx, value);
+  }
+}
+
+void dc::AudioBuffer::fill(size_t channel, float value)
+{
+  if (value == 0.0f)
+  {
+    zero(channel);
+    return;
+  }
+
+  if (channel < _numChannels)
+  {
+    getAudioKernels().fill(_data + channel * _stride, value, _numSamples);
+    setSilent(channel, false);
+  }
 }
 
 void dc::AudioBuffer::zero()
 {
-  memset(_data, 0, _allocatedSize * sizeof(float));
+  for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
+  {
+    zero(cIdx);
+  }
 }
 
 void dc::AudioBuffer::zero(size_t channel)
 {
-  if (float* start = getChannelPointer(channel))
+  if (channel < _numChannels && !_silent[channel])
   {
-    memset(start, 0, _numSamples * sizeof(float));
+    memset(_data + channel * _stride, 0, _numSamples * sizeof(float));
+    setSilent(channel, true);
   }
 }
 
@@ -94,19 +297,10 @@ void dc::AudioBuffer::copyFrom(const AudioBuffer& other, bool allowResize)
     resize(other._numSamples, other._numChannels);
   }
 
-  // if buffers are the same size, shortcut
-  if (_numSamples == other._numSamples && _numChannels == other._numChannels)
-  {
-    memcpy(_data, other._data, _allocatedSize * sizeof(float));
-  }
-  else
+  const size_t numChannelsToCopy = std::min(_numChannels, other._numChannels);
+  for (size_t cIdx = 0; cIdx < numChannelsToCopy; ++cIdx)
   {
-    const size_t numChannelsToCopy = std::min(_numChannels, other._numChannels);
-
-    for (size_t cIdx = 0; cIdx < numChannelsToCopy; ++cIdx)
-    {
-      copyFrom(other, cIdx, cIdx);
-    }
+    copyFrom(other, cIdx, cIdx);
   }
 }
 
@@ -115,9 +309,25 @@ void dc::AudioBuffer::copyFrom(const AudioBuffer& other, size_t fromChannel, siz
   if (fromChannel < other.getNumChannels() && toChannel < _numChannels)
   {
     const size_t numSamplesToCopy = std::min(_numSamples, other._numSamples);
-    float* from = other._data + fromChannel * other._numSamples;
-    float* to = _data + toChannel * _numSamples;
+    float* to = _data + toChannel * _stride;
+
+    if (other._silent[fromChannel])
+    {
+      // copying silence over a whole channel that's already silent is a no-op
+      if (numSamplesToCopy == _numSamples)
+      {
+        zero(toChannel);
+      }
+      else
+      {
+        memset(to, 0, numSamplesToCopy * sizeof(float));
+      }
+      return;
+    }
+
+    const float* from = other._data + fromChannel * other._stride;
     memcpy(to, from, numSamplesToCopy * sizeof(float));
+    setSilent(toChannel, false);
   }
 }
 
@@ -134,120 +344,305 @@ void dc::AudioBuffer::addFrom(const AudioBuffer& other, size_t fromChannel, size
 {
   if (fromChannel < other.getNumChannels() && toChannel < _numChannels)
   {
+    // adding silence doesn't change anything
+    if (other._silent[fromChannel])
+    {
+      return;
+    }
+
     const size_t numSamplesToAdd = std::min(_numSamples, other._numSamples);
-    float* fromPtr = other._data + fromChannel * other._numSamples;
-    float* toPtr = _data + toChannel * _numSamples;
-    for (size_t sIdx = 0; sIdx < numSamplesToAdd; ++sIdx)
+    const float* fromPtr = other._data + fromChannel * other._stride;
+    float* toPtr = _data + toChannel * _stride;
+
+    // and adding to silence is just a copy
+    if (_silent[toChannel])
     {
-      toPtr[sIdx] += fromPtr[sIdx];
+      memcpy(toPtr, fromPtr, numSamplesToAdd * sizeof(float));
     }
+    else
+    {
+      getAudioKernels().add(toPtr, fromPtr, numSamplesToAdd);
+    }
+    setSilent(toChannel, false);
   }
 }
 
-void dc::AudioBuffer::applyGain(float gain)
+void dc::AudioBuffer::addFromWithGain(const AudioBuffer& other, size_t fromChannel, size_t toChannel, float gain)
 {
-  for (size_t i = 0; i < _allocatedSize; ++i)
+  if (fromChannel < other.getNumChannels() && toChannel < _numChannels)
   {
-    _data[i] *= gain;
+    if (other._silent[fromChannel] || gain == 0.0f)
+    {
+      return;
+    }
+
+    if (_silent[toChannel])
+    {
+      copyFromWithGain(other, fromChannel, toChannel, gain);
+      return;
+    }
+
+    const size_t numSamplesToAdd = std::min(_numSamples, other._numSamples);
+    getAudioKernels().addWithGain(_data + toChannel * _stride, other._data + fromChannel * other._stride,
+                                  gain, numSamplesToAdd);
   }
 }
 
-void dc::AudioBuffer::applyGain(size_t channel, float gain)
+void dc::AudioBuffer::copyFromWithGain(const AudioBuffer& other, size_t fromChannel, size_t toChannel, float gain)
 {
-  if (auto* cPtr = getChannelPointer(channel))
+  if (fromChannel < other.getNumChannels() && toChannel < _numChannels)
   {
-    for (size_t sIdx = 0; sIdx < _numSamples; ++sIdx)
+    // no gain is the same as copying silence
+    if (gain == 0.0f && !other._silent[fromChannel])
     {
-      cPtr[sIdx] *= gain;
+      const size_t numSamplesToCopy = std::min(_numSamples, other._numSamples);
+      if (numSamplesToCopy == _numSamples)
+      {
+        zero(toChannel);
+      }
+      else
+      {
+        memset(_data + toChannel * _stride, 0, numSamplesToCopy * sizeof(float));
+      }
+      return;
     }
+
+    if (other._silent[fromChannel])
+    {
+      copyFrom(other, fromChannel, toChannel);
+      return;
+    }
+
+    const size_t numSamplesToCopy = std::min(_numSamples, other._numSamples);
+    getAudioKernels().copyWithGain(_data + toChannel * _stride, other._data + fromChannel * other._stride,
+                                   gain, numSamplesToCopy);
+    setSilent(toChannel, false);
+  }
+}
+
+void dc::AudioBuffer::addFromWithRamp(const AudioBuffer& other, size_t fromChannel, size_t toChannel,
+                                      float startGain, float endGain)
+{
+  if (fromChannel < other.getNumChannels() && toChannel < _numChannels)
+  {
+    if (other._silent[fromChannel] || (startGain == 0.0f && endGain == 0.0f))
+    {
+      return;
+    }
+
+    const size_t numSamplesToAdd = std::min(_numSamples, other._numSamples);
+    float* toPtr = _data + toChannel * _stride;
+    if (_silent[toChannel])
+    {
+      memset(toPtr, 0, numSamplesToAdd * sizeof(float));
+    }
+
+    const float gainStep = (endGain - startGain) / static_cast<float>(_numSamples);
+    getAudioKernels().addWithGainRamp(toPtr, other._data + fromChannel * other._stride, startGain, gainStep,
+                                      numSamplesToAdd);
+    setSilent(toChannel, false);
+  }
+}
+
+void dc::AudioBuffer::applyGain(float gain)
+{
+  for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
+  {
+    applyGain(cIdx, gain);
+  }
+}
+
+void dc::AudioBuffer::applyGain(size_t channel, float gain)
+{
+  if (channel < _numChannels && !_silent[channel])
+  {
+    getAudioKernels().applyGain(_data + channel * _stride, gain, _numSamples);
   }
 }
 
 void dc::AudioBuffer::fromInterleaved(const float* buffer, size_t numSamples, size_t numChannels, bool allowResize)
 {
-  if (allowResize && numSamples != _numSamples && numChannels != _numChannels)
+  if (allowResize)
   {
     resize(numSamples, numChannels);
   }
-  for (size_t sIdx = 0; sIdx < _numSamples; ++sIdx)
+
+  const size_t numChannelsToCopy = std::min(_numChannels, numChannels);
+  for (size_t cIdx = 0; cIdx < numChannelsToCopy; ++cIdx)
+  {
+    setSilent(cIdx, false);
+  }
+  getAudioKernels().deinterleave(_data, _stride, buffer, numChannels, numChannelsToCopy,
+                                 std::min(_numSamples, numSamples));
+}
+
+void dc::AudioBuffer::toInterleaved(float* buffer, size_t numSamples, size_t numChannels)
+{
+  const size_t numChannelsToCopy = std::min(_numChannels, numChannels);
+  const size_t numSamplesToCopy = std::min(_numSamples, numSamples);
+  getAudioKernels().interleave(buffer, numChannels, _data, _stride, numChannelsToCopy, numSamplesToCopy);
+
+  // zero whatever this buffer doesn't have
+  for (size_t sIdx = 0; sIdx < numSamplesToCopy; ++sIdx)
   {
-    if (sIdx >= numSamples)
+    for (size_t cIdx = numChannelsToCopy; cIdx < numChannels; ++cIdx)
     {
-      break;
+      buffer[cIdx + sIdx * numChannels] = 0;
     }
+  }
+  if (numSamplesToCopy < numSamples)
+  {
+    memset(buffer + numSamplesToCopy * numChannels, 0, (numSamples - numSamplesToCopy) * numChannels * sizeof(float));
+  }
+}
 
-    for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
+void dc::AudioBuffer::fromInterleaved(const void* buffer, SampleFormat format, size_t numSamples, size_t numChannels,
+                                      bool allowResize)
+{
+  if (allowResize)
+  {
+    resize(numSamples, numChannels);
+  }
+
+  const size_t numChannelsToCopy = std::min(_numChannels, numChannels);
+  const size_t numSamplesToCopy = std::min(_numSamples, numSamples);
+  if (numChannelsToCopy == 0)
+  {
+    return;
+  }
+  for (size_t cIdx = 0; cIdx < numChannelsToCopy; ++cIdx)
+  {
+    setSilent(cIdx, false);
+  }
+
+  const auto& kernels = getAudioKernels();
+  const auto* src = static_cast<const uint8_t*>(buffer);
+  const size_t sampleSize = getSampleSize(format);
+  const size_t frameSize = numChannels * sampleSize;
+
+  // convert a block of whole frames at a time, then de-interleave the block
+  float block[CONVERSION_BLOCK_SIZE];
+  const size_t framesPerBlock = CONVERSION_BLOCK_SIZE / numChannels;
+  if (framesPerBlock == 0)
+  {
+    // frames too big for the block go a sample at a time
+    for (size_t sIdx = 0; sIdx < numSamplesToCopy; ++sIdx)
     {
-      if (cIdx >= numChannels)
+      for (size_t cIdx = 0; cIdx < numChannelsToCopy; ++cIdx)
       {
-        break;
+        toFloat(kernels, _data + cIdx * _stride + sIdx, src + sIdx * frameSize + cIdx * sampleSize, format, 1);
       }
-      _data[sIdx + cIdx * _numSamples] = buffer[cIdx + sIdx * numChannels];
     }
+    return;
+  }
+
+  for (size_t sIdx = 0; sIdx < numSamplesToCopy; sIdx += framesPerBlock)
+  {
+    const size_t numFrames = std::min(framesPerBlock, numSamplesToCopy - sIdx);
+    toFloat(kernels, block, src + sIdx * frameSize, format, numFrames * numChannels);
+    kernels.deinterleave(_data + sIdx, _stride, block, numChannels, numChannelsToCopy, numFrames);
   }
 }
 
-void dc::AudioBuffer::toInterleaved(float* buffer, size_t numSamples, size_t numChannels)
+void dc::AudioBuffer::toInterleaved(void* buffer, SampleFormat format, size_t numSamples, size_t numChannels)
 {
-  for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+  if (numChannels == 0)
+  {
+    return;
+  }
+
+  const size_t numChannelsToCopy = std::min(_numChannels, numChannels);
+  const size_t numSamplesToCopy = std::min(_numSamples, numSamples);
+  const auto& kernels = getAudioKernels();
+  auto* dst = static_cast<uint8_t*>(buffer);
+  const size_t sampleSize = getSampleSize(format);
+  const size_t frameSize = numChannels * sampleSize;
+
+  // interleave a block of whole frames at a time, then convert the block
+  float block[CONVERSION_BLOCK_SIZE];
+  const size_t framesPerBlock = CONVERSION_BLOCK_SIZE / numChannels;
+  if (framesPerBlock == 0)
   {
-    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    for (size_t sIdx = 0; sIdx < numSamplesToCopy; ++sIdx)
     {
-      if (cIdx >= _numChannels || sIdx >= _numSamples)
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
       {
-        buffer[cIdx + sIdx * numChannels] = 0;
+        const float sample = cIdx < numChannelsToCopy ? _data[cIdx * _stride + sIdx] : 0.0f;
+        fromFloat(kernels, dst + sIdx * frameSize + cIdx * sampleSize, &sample, format, 1);
       }
-      else
+    }
+  }
+  else
+  {
+    for (size_t sIdx = 0; sIdx < numSamplesToCopy; sIdx += framesPerBlock)
+    {
+      const size_t numFrames = std::min(framesPerBlock, numSamplesToCopy - sIdx);
+      kernels.interleave(block, numChannels, _data + sIdx, _stride, numChannelsToCopy, numFrames);
+      for (size_t fIdx = 0; fIdx < numFrames; ++fIdx)
       {
-        buffer[cIdx + sIdx * numChannels] = _data[sIdx + cIdx * _numSamples];
+        for (size_t cIdx = numChannelsToCopy; cIdx < numChannels; ++cIdx)
+        {
+          block[cIdx + fIdx * numChannels] = 0.0f;
+        }
       }
+      fromFloat(kernels, dst + sIdx * frameSize, block, format, numFrames * numChannels);
     }
   }
+
+  // zero is all zero bits in every format
+  if (numSamplesToCopy < numSamples)
+  {
+    memset(dst + numSamplesToCopy * frameSize, 0, (numSamples - numSamplesToCopy) * frameSize);
+  }
 }
 
 float* dc::AudioBuffer::getChannelPointer(size_t channel)
 {
   if (channel < _numChannels)
   {
-    return _data + channel * _numSamples;
+    setSilent(channel, false);
+    return _data + channel * _stride;
   }
 
   return nullptr;
 }
 
-float dc::AudioBuffer::getRms(size_t channel) const
+float* dc::AudioBuffer::getWritableData()
 {
-  if (channel >= _numChannels)
+  for (size_t cIdx = 0; cIdx < _numChannels; ++cIdx)
   {
-    return 0;
+    setSilent(cIdx, false);
+  }
+  return _data;
+}
+
+const float* dc::AudioBuffer::getChannelPointer(size_t channel) const
+{
+  if (channel < _numChannels)
+  {
+    return _data + channel * _stride;
   }
 
-  auto* cPtr = _data + channel * _numSamples;
-  float sum = 0.0f;
-  for (size_t sIdx = 0; sIdx < _numSamples; ++sIdx)
+  return nullptr;
+}
+
+float dc::AudioBuffer::getRms(size_t channel) const
+{
+  if (channel >= _numChannels || _silent[channel])
   {
-    const float sample = cPtr[sIdx];
-    sum += sample * sample;
+    return 0;
   }
+
+  const float sum = getAudioKernels().sumOfSquares(_data + channel * _stride, _numSamples);
   return std::sqrt(sum / _numSamples);
 }
 
 float dc::AudioBuffer::getPeak(size_t channel) const
 {
-  if (channel >= _numChannels)
+  if (channel >= _numChannels || _silent[channel])
   {
     return 0;
   }
 
-  auto* cPtr = _data + channel * _numSamples;
-  float peak = 0;
-  for (size_t sIdx = 0; sIdx < _numSamples; ++sIdx)
-  {
-    const float val = std::abs(cPtr[sIdx]);
-    if (val > peak)
-    {
-      peak = val;
-    }
-  }
-  return peak;
+  return getAudioKernels().peak(_data + channel * _stride, _numSamples);
 }
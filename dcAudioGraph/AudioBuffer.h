@@ -1,5 +1,7 @@
 /*
  * a de-interleaved audio buffer
+ * Each channel starts on a cache line, and channels are padded out to a whole number of cache lines,
+ * so vector code can use aligned loads and threads working on different channels don't share lines.
  * Note: this class is not thread-safe, so if you're operating on one in multiple threads,
  * be sure to implement your own synchronization
  */
@@ -7,12 +9,28 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 
 namespace dc
 {
 class AudioBuffer final
 {
 public:
+  // in bytes, for the buffer's own memory
+  static const size_t ALIGNMENT = 64;
+
+  // Fixed point formats for interleaved I/O, like sound cards use.
+  // Int16 and Int32 are native-endian, Int24 is packed into 3 bytes, little-endian.
+  enum class SampleFormat
+  {
+    Int16,
+    Int24,
+    Int32
+  };
+
+  // the distance between channels, in samples, for a buffer with this many samples per channel
+  static size_t getPaddedStride(size_t numSamples);
+
   // creates an empty buffer that's not useful until resize() is called
   AudioBuffer() = default;
 
@@ -25,10 +43,10 @@ public:
 
   AudioBuffer& operator=(const AudioBuffer& other);
 
-  // don't need these for now
-  AudioBuffer(AudioBuffer&& other) = delete;
+  // moving takes the memory, and leaves the other buffer empty
+  AudioBuffer(AudioBuffer&& other) noexcept;
 
-  AudioBuffer& operator=(AudioBuffer&& other) = delete;
+  AudioBuffer& operator=(AudioBuffer&& other) noexcept;
 
   ~AudioBuffer();
 
@@ -38,12 +56,34 @@ public:
   // get the number of channels in the buffer
   size_t getNumChannels() const { return _numChannels; }
 
+  // get the distance between the start of one channel and the next, in samples
+  size_t getChannelStride() const { return _stride; }
+
   // set the number of samples and channels in the buffer
   // Note: the buffer will be filled with garbage. Clear it out before you use it.
   // Note: this will reallocate the underlying data if the total size increases,
   // so don't call this on the audio thread unless you're sure you're downsizing
   void resize(size_t numSamples, size_t numChannels);
 
+  // Point the buffer at memory owned by someone else, instead of its own.
+  // Channels start channelStride samples apart. Use getPaddedStride() and ALIGNMENT to match the buffer's own layout.
+  // silenceFlags can point at one flag per channel, to share them with whoever owns the memory,
+  // or be nullptr for the buffer to keep its own. Shared flags are trusted, so a channel flagged as silent
+  // isn't cleared again, and whoever writes to the memory some other way has to clear its flag.
+  // Note: the memory has to stay around for as long as the buffer uses it.
+  // Resizing past the end of it will give the buffer its own memory again.
+  void setExternalData(float* data, bool* silenceFlags, size_t numSamples, size_t numChannels,
+                       size_t channelStride);
+
+  // Silence flags
+  // A channel flagged as silent is known to be all zeros, so work on it can be skipped.
+  // The functions in here keep the flags up to date. Getting a writable channel pointer assumes you're going to
+  // write through it, so it clears the flag for that channel. To write across channels, use getWritableData().
+  bool isSilent(size_t channel) const;
+
+  // true if every channel is silent
+  bool isSilent() const;
+
   // fill the buffer with a value
   void fill(float value);
 
@@ -71,6 +111,17 @@ public:
   // add the contents of a channel to a channel in this buffer
   void addFrom(const AudioBuffer& other, size_t fromChannel, size_t toChannel);
 
+  // add the contents of a channel to a channel in this buffer, with gain
+  void addFromWithGain(const AudioBuffer& other, size_t fromChannel, size_t toChannel, float gain);
+
+  // copy the contents of a channel to a channel in this buffer, with gain
+  void copyFromWithGain(const AudioBuffer& other, size_t fromChannel, size_t toChannel, float gain);
+
+  // add the contents of a channel to a channel in this buffer, with gain ramping from startGain towards endGain
+  // Note: endGain is the gain one sample past the end, so the next block can start from it without a step
+  void addFromWithRamp(const AudioBuffer& other, size_t fromChannel, size_t toChannel, float startGain,
+                       float endGain);
+
   // apply gain to the whole buffer
   void applyGain(float gain);
 
@@ -85,20 +136,45 @@ public:
   // copies the contents of this buffer to an interleaved raw buffer
   void toInterleaved(float* buffer, size_t numSamples, size_t numChannels);
 
+  // same as above, for fixed point samples
+  void fromInterleaved(const void* buffer, SampleFormat format, size_t numSamples, size_t numChannels,
+                       bool allowResize);
+
+  void toInterleaved(void* buffer, SampleFormat format, size_t numSamples, size_t numChannels);
+
   // Get the RMS level of a channel in the buffer
   float getRms(size_t channel) const;
 
   // Get the peak level of a channel in the buffer
   float getPeak(size_t channel) const;
 
-  // get a pointer to a channel in this buffer
-  // Note: if you want to iterate the whole buffer, just get channel 0
+  // get a pointer to a channel in this buffer, to write that channel only
   float* getChannelPointer(size_t channel);
 
+  // Get a pointer to the start of the buffer, to write across all of its channels,
+  // stepping getChannelStride() samples from one channel to the next. Clears every channel's silence flag.
+  float* getWritableData();
+
+  // get a read-only pointer to a channel in this buffer, which leaves the silence flags alone
+  const float* getChannelPointer(size_t channel) const;
+
 private:
+  void useOwnSilenceFlags(size_t numChannels);
+
+  void setSilent(size_t channel, bool silent) { _silent[channel] = silent; }
+
+  void releaseData();
+
   float* _data = nullptr;
   size_t _numSamples = 0;
   size_t _numChannels = 0;
+  size_t _stride = 0;
   size_t _allocatedSize = 0;
+  bool _ownsData = true;
+
+  // one per channel, either our own or shared with whoever owns the external data
+  bool* _silent = nullptr;
+  std::unique_ptr<bool[]> _ownSilenceFlags;
+  size_t _numOwnSilenceFlags = 0;
 };
 }
@@ -0,0 +1,977 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include "AudioKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DC_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DC_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace dc
+{
+// built separately, with AVX2 turned on for just that file
+const AudioKernels* getAvx2AudioKernels();
+}
+
+namespace
+{
+void fillScalar(float* dst, float value, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = value;
+  }
+}
+
+void addScalar(float* dst, const float* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] += src[i];
+  }
+}
+
+void addWithGainScalar(float* dst, const float* src, float gain, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * gain;
+  }
+}
+
+void copyWithGainScalar(float* dst, const float* src, float gain, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = src[i] * gain;
+  }
+}
+
+void applyGainScalar(float* dst, float gain, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] *= gain;
+  }
+}
+
+void addWithGainRampScalar(float* dst, const float* src, float startGain, float gainStep, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * (startGain + gainStep * static_cast<float>(i));
+  }
+}
+
+void rampScalar(float* dst, float start, float step, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = start + step * static_cast<float>(i);
+  }
+}
+
+void multiplyScalar(float* dst, const float* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] *= src[i];
+  }
+}
+
+void lookupScalar(float* dst, const float* src, const float* table, size_t tableSize, float scale, float offset,
+                  size_t numSamples)
+{
+  const float last = static_cast<float>(tableSize - 1);
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const float position = std::min(last, std::max(0.0f, src[i] * scale + offset));
+    const auto index = static_cast<int32_t>(position);
+    const float frac = position - static_cast<float>(index);
+    dst[i] = table[index] + (table[index + 1] - table[index]) * frac;
+  }
+}
+
+float sumOfSquaresScalar(const float* src, size_t numSamples)
+{
+  float sum = 0.0f;
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    sum += src[i] * src[i];
+  }
+  return sum;
+}
+
+float peakScalar(const float* src, size_t numSamples)
+{
+  float peak = 0.0f;
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const float val = std::abs(src[i]);
+    if (val > peak)
+    {
+      peak = val;
+    }
+  }
+  return peak;
+}
+
+void interleaveScalar(float* dst, size_t frameSize, const float* src, size_t srcStride, size_t numChannels,
+                      size_t numSamples)
+{
+  for (size_t c = 0; c < numChannels; ++c)
+  {
+    const float* channel = src + c * srcStride;
+    for (size_t s = 0; s < numSamples; ++s)
+    {
+      dst[s * frameSize + c] = channel[s];
+    }
+  }
+}
+
+void deinterleaveScalar(float* dst, size_t dstStride, const float* src, size_t frameSize, size_t numChannels,
+                        size_t numSamples)
+{
+  for (size_t c = 0; c < numChannels; ++c)
+  {
+    float* channel = dst + c * dstStride;
+    for (size_t s = 0; s < numSamples; ++s)
+    {
+      channel[s] = src[s * frameSize + c];
+    }
+  }
+}
+
+// full scale for each format, and the largest value that can be converted back without overflowing
+const float INT16_SCALE = 32768.0f;
+const float INT16_MAX_SCALED = 32767.0f;
+const float INT24_SCALE = 8388608.0f;
+const float INT24_MAX_SCALED = 8388607.0f;
+const float INT32_SCALE = 2147483648.0f;
+// the largest float below 2^31
+const float INT32_MAX_SCALED = 2147483520.0f;
+
+// scale, clamp, and round to nearest like the vector conversions do
+long toFixed(float sample, float scale, float maxScaled)
+{
+  return std::lrint(std::min(std::max(sample * scale, -scale), maxScaled));
+}
+
+void int16ToFloatScalar(float* dst, const int16_t* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<float>(src[i]) * (1.0f / INT16_SCALE);
+  }
+}
+
+void floatToInt16Scalar(int16_t* dst, const float* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<int16_t>(toFixed(src[i], INT16_SCALE, INT16_MAX_SCALED));
+  }
+}
+
+void int24ToFloatScalar(float* dst, const uint8_t* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const uint8_t* bytes = src + i * 3;
+    int32_t value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+    if (value & 0x800000)
+    {
+      value -= 0x1000000;
+    }
+    dst[i] = static_cast<float>(value) * (1.0f / INT24_SCALE);
+  }
+}
+
+void floatToInt24Scalar(uint8_t* dst, const float* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    const auto value = static_cast<uint32_t>(toFixed(src[i], INT24_SCALE, INT24_MAX_SCALED));
+    uint8_t* bytes = dst + i * 3;
+    bytes[0] = static_cast<uint8_t>(value);
+    bytes[1] = static_cast<uint8_t>(value >> 8);
+    bytes[2] = static_cast<uint8_t>(value >> 16);
+  }
+}
+
+void int32ToFloatScalar(float* dst, const int32_t* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<float>(src[i]) * (1.0f / INT32_SCALE);
+  }
+}
+
+void floatToInt32Scalar(int32_t* dst, const float* src, size_t numSamples)
+{
+  for (size_t i = 0; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<int32_t>(toFixed(src[i], INT32_SCALE, INT32_MAX_SCALED));
+  }
+}
+
+const dc::AudioKernels scalarKernels = {dc::AudioKernels::Isa::Scalar, "scalar", fillScalar, addScalar,
+                                        addWithGainScalar, copyWithGainScalar, applyGainScalar,
+                                        addWithGainRampScalar, rampScalar, multiplyScalar, lookupScalar,
+                                        sumOfSquaresScalar, peakScalar, interleaveScalar, deinterleaveScalar, int16ToFloatScalar,
+                                        floatToInt16Scalar, int24ToFloatScalar, floatToInt24Scalar,
+                                        int32ToFloatScalar, floatToInt32Scalar};
+
+#ifdef DC_KERNELS_SSE2
+// 4 samples at a time, and the scalar versions mop up what's left
+void fillSse2(float* dst, float value, size_t numSamples)
+{
+  const __m128 v = _mm_set1_ps(value);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, v);
+  }
+  fillScalar(dst + i, value, numSamples - i);
+}
+
+void addSse2(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+  }
+  addScalar(dst + i, src + i, numSamples - i);
+}
+
+void addWithGainSse2(float* dst, const float* src, float gain, size_t numSamples)
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+  }
+  addWithGainScalar(dst + i, src + i, gain, numSamples - i);
+}
+
+void copyWithGainSse2(float* dst, const float* src, float gain, size_t numSamples)
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+  }
+  copyWithGainScalar(dst + i, src + i, gain, numSamples - i);
+}
+
+void applyGainSse2(float* dst, float gain, size_t numSamples)
+{
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), g));
+  }
+  applyGainScalar(dst + i, gain, numSamples - i);
+}
+
+void addWithGainRampSse2(float* dst, const float* src, float startGain, float gainStep, size_t numSamples)
+{
+  // the gain is worked out from the sample index each time, so it doesn't drift like a running sum would
+  const __m128 start = _mm_set1_ps(startGain);
+  const __m128 step = _mm_set1_ps(gainStep);
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const __m128 g = _mm_add_ps(start, _mm_mul_ps(step, index));
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+    index = _mm_add_ps(index, four);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * (startGain + gainStep * static_cast<float>(i));
+  }
+}
+
+void rampSse2(float* dst, float start, float step, size_t numSamples)
+{
+  const __m128 s = _mm_set1_ps(start);
+  const __m128 st = _mm_set1_ps(step);
+  __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_add_ps(s, _mm_mul_ps(st, index)));
+    index = _mm_add_ps(index, four);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = start + step * static_cast<float>(i);
+  }
+}
+
+void multiplySse2(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+  }
+  multiplyScalar(dst + i, src + i, numSamples - i);
+}
+
+float sumOfSquaresSse2(const float* src, size_t numSamples)
+{
+  __m128 sum = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const __m128 v = _mm_loadu_ps(src + i);
+    sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, sum);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumOfSquaresScalar(src + i, numSamples - i);
+}
+
+float peakSse2(const float* src, size_t numSamples)
+{
+  // clearing the sign bit is abs()
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 peak = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(src + i), absMask));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, peak);
+  float result = peakScalar(src + i, numSamples - i);
+  for (auto lane : lanes)
+  {
+    if (lane > result)
+    {
+      result = lane;
+    }
+  }
+  return result;
+}
+
+// Transposes go 4 channels by 4 samples at a time.
+// FrameSize is 0 when it's only known at runtime, and a constant for the common layouts, so they get unrolled.
+template <size_t FrameSize>
+void interleaveBlockedSse2(float* dst, size_t frameSize, const float* src, size_t srcStride, size_t numChannels,
+                           size_t numSamples)
+{
+  const size_t fs = FrameSize > 0 ? FrameSize : frameSize;
+  size_t c = 0;
+  for (; c + 4 <= numChannels; c += 4)
+  {
+    const float* s0 = src + c * srcStride;
+    const float* s1 = s0 + srcStride;
+    const float* s2 = s1 + srcStride;
+    const float* s3 = s2 + srcStride;
+    float* d = dst + c;
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      __m128 r0 = _mm_loadu_ps(s0 + s);
+      __m128 r1 = _mm_loadu_ps(s1 + s);
+      __m128 r2 = _mm_loadu_ps(s2 + s);
+      __m128 r3 = _mm_loadu_ps(s3 + s);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(d + s * fs, r0);
+      _mm_storeu_ps(d + (s + 1) * fs, r1);
+      _mm_storeu_ps(d + (s + 2) * fs, r2);
+      _mm_storeu_ps(d + (s + 3) * fs, r3);
+    }
+    interleaveScalar(dst + s * fs + c, fs, s0 + s, srcStride, 4, numSamples - s);
+  }
+  interleaveScalar(dst + c, fs, src + c * srcStride, srcStride, numChannels - c, numSamples);
+}
+
+template <size_t FrameSize>
+void deinterleaveBlockedSse2(float* dst, size_t dstStride, const float* src, size_t frameSize, size_t numChannels,
+                             size_t numSamples)
+{
+  const size_t fs = FrameSize > 0 ? FrameSize : frameSize;
+  size_t c = 0;
+  for (; c + 4 <= numChannels; c += 4)
+  {
+    float* d0 = dst + c * dstStride;
+    float* d1 = d0 + dstStride;
+    float* d2 = d1 + dstStride;
+    float* d3 = d2 + dstStride;
+    const float* sPtr = src + c;
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      __m128 r0 = _mm_loadu_ps(sPtr + s * fs);
+      __m128 r1 = _mm_loadu_ps(sPtr + (s + 1) * fs);
+      __m128 r2 = _mm_loadu_ps(sPtr + (s + 2) * fs);
+      __m128 r3 = _mm_loadu_ps(sPtr + (s + 3) * fs);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(d0 + s, r0);
+      _mm_storeu_ps(d1 + s, r1);
+      _mm_storeu_ps(d2 + s, r2);
+      _mm_storeu_ps(d3 + s, r3);
+    }
+    deinterleaveScalar(d0 + s, dstStride, src + s * fs + c, fs, 4, numSamples - s);
+  }
+  deinterleaveScalar(dst + c * dstStride, dstStride, src + c, fs, numChannels - c, numSamples);
+}
+
+void interleaveSse2(float* dst, size_t frameSize, const float* src, size_t srcStride, size_t numChannels,
+                    size_t numSamples)
+{
+  if (frameSize == numChannels)
+  {
+    switch (numChannels)
+    {
+      case 1:
+        memcpy(dst, src, numSamples * sizeof(float));
+        return;
+
+      case 2:
+      {
+        const float* left = src;
+        const float* right = src + srcStride;
+        size_t s = 0;
+        for (; s + 4 <= numSamples; s += 4)
+        {
+          const __m128 l = _mm_loadu_ps(left + s);
+          const __m128 r = _mm_loadu_ps(right + s);
+          _mm_storeu_ps(dst + 2 * s, _mm_unpacklo_ps(l, r));
+          _mm_storeu_ps(dst + 2 * s + 4, _mm_unpackhi_ps(l, r));
+        }
+        interleaveScalar(dst + 2 * s, 2, src + s, srcStride, 2, numSamples - s);
+        return;
+      }
+
+      case 4:
+        interleaveBlockedSse2<4>(dst, frameSize, src, srcStride, numChannels, numSamples);
+        return;
+
+      case 8:
+        interleaveBlockedSse2<8>(dst, frameSize, src, srcStride, numChannels, numSamples);
+        return;
+
+      case 16:
+        interleaveBlockedSse2<16>(dst, frameSize, src, srcStride, numChannels, numSamples);
+        return;
+
+      default:
+        break;
+    }
+  }
+  interleaveBlockedSse2<0>(dst, frameSize, src, srcStride, numChannels, numSamples);
+}
+
+void deinterleaveSse2(float* dst, size_t dstStride, const float* src, size_t frameSize, size_t numChannels,
+                      size_t numSamples)
+{
+  if (frameSize == numChannels)
+  {
+    switch (numChannels)
+    {
+      case 1:
+        memcpy(dst, src, numSamples * sizeof(float));
+        return;
+
+      case 2:
+      {
+        float* left = dst;
+        float* right = dst + dstStride;
+        size_t s = 0;
+        for (; s + 4 <= numSamples; s += 4)
+        {
+          const __m128 a = _mm_loadu_ps(src + 2 * s);
+          const __m128 b = _mm_loadu_ps(src + 2 * s + 4);
+          _mm_storeu_ps(left + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+          _mm_storeu_ps(right + s, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+        deinterleaveScalar(dst + s, dstStride, src + 2 * s, 2, 2, numSamples - s);
+        return;
+      }
+
+      case 4:
+        deinterleaveBlockedSse2<4>(dst, dstStride, src, frameSize, numChannels, numSamples);
+        return;
+
+      case 8:
+        deinterleaveBlockedSse2<8>(dst, dstStride, src, frameSize, numChannels, numSamples);
+        return;
+
+      case 16:
+        deinterleaveBlockedSse2<16>(dst, dstStride, src, frameSize, numChannels, numSamples);
+        return;
+
+      default:
+        break;
+    }
+  }
+  deinterleaveBlockedSse2<0>(dst, dstStride, src, frameSize, numChannels, numSamples);
+}
+
+void int16ToFloatSse2(float* dst, const int16_t* src, size_t numSamples)
+{
+  const __m128 scale = _mm_set1_ps(1.0f / INT16_SCALE);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    // putting each sample in the top half of a 32 bit lane and shifting it back down sign extends it
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+  int16ToFloatScalar(dst + i, src + i, numSamples - i);
+}
+
+void floatToInt16Sse2(int16_t* dst, const float* src, size_t numSamples)
+{
+  const __m128 scale = _mm_set1_ps(INT16_SCALE);
+  const __m128 minScaled = _mm_set1_ps(-INT16_SCALE);
+  const __m128 maxScaled = _mm_set1_ps(INT16_MAX_SCALED);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    const __m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minScaled), maxScaled);
+    const __m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), minScaled), maxScaled);
+    const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+  floatToInt16Scalar(dst + i, src + i, numSamples - i);
+}
+
+void int32ToFloatSse2(float* dst, const int32_t* src, size_t numSamples)
+{
+  const __m128 scale = _mm_set1_ps(1.0f / INT32_SCALE);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+  }
+  int32ToFloatScalar(dst + i, src + i, numSamples - i);
+}
+
+void floatToInt32Sse2(int32_t* dst, const float* src, size_t numSamples)
+{
+  const __m128 scale = _mm_set1_ps(INT32_SCALE);
+  const __m128 minScaled = _mm_set1_ps(-INT32_SCALE);
+  const __m128 maxScaled = _mm_set1_ps(INT32_MAX_SCALED);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minScaled), maxScaled);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(v));
+  }
+  floatToInt32Scalar(dst + i, src + i, numSamples - i);
+}
+
+// There's no quick way to shuffle packed 24 bit samples with SSE2, so this just does the rounding in vectors,
+// and packs the bytes one at a time. Reading them in stays scalar, since there's no rounding to do.
+void floatToInt24Sse2(uint8_t* dst, const float* src, size_t numSamples)
+{
+  const __m128 scale = _mm_set1_ps(INT24_SCALE);
+  const __m128 minScaled = _mm_set1_ps(-INT24_SCALE);
+  const __m128 maxScaled = _mm_set1_ps(INT24_MAX_SCALED);
+  int32_t values[4];
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minScaled), maxScaled);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values), _mm_cvtps_epi32(v));
+    uint8_t* bytes = dst + i * 3;
+    for (size_t j = 0; j < 4; ++j)
+    {
+      const auto value = static_cast<uint32_t>(values[j]);
+      bytes[j * 3] = static_cast<uint8_t>(value);
+      bytes[j * 3 + 1] = static_cast<uint8_t>(value >> 8);
+      bytes[j * 3 + 2] = static_cast<uint8_t>(value >> 16);
+    }
+  }
+  floatToInt24Scalar(dst + i * 3, src + i, numSamples - i);
+}
+
+const dc::AudioKernels sse2Kernels = {dc::AudioKernels::Isa::Sse2, "sse2", fillSse2, addSse2, addWithGainSse2,
+                                      copyWithGainSse2, applyGainSse2, addWithGainRampSse2, rampSse2,
+                                      multiplySse2, nullptr, sumOfSquaresSse2, peakSse2, interleaveSse2, deinterleaveSse2,
+                                      int16ToFloatSse2, floatToInt16Sse2, nullptr, floatToInt24Sse2,
+                                      int32ToFloatSse2, floatToInt32Sse2};
+#endif
+
+#ifdef DC_KERNELS_NEON
+void fillNeon(float* dst, float value, size_t numSamples)
+{
+  const float32x4_t v = vdupq_n_f32(value);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, v);
+  }
+  fillScalar(dst + i, value, numSamples - i);
+}
+
+void addNeon(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+  }
+  addScalar(dst + i, src + i, numSamples - i);
+}
+
+void addWithGainNeon(float* dst, const float* src, float gain, size_t numSamples)
+{
+  const float32x4_t g = vdupq_n_f32(gain);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+  }
+  addWithGainScalar(dst + i, src + i, gain, numSamples - i);
+}
+
+void copyWithGainNeon(float* dst, const float* src, float gain, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+  }
+  copyWithGainScalar(dst + i, src + i, gain, numSamples - i);
+}
+
+void applyGainNeon(float* dst, float gain, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(dst + i), gain));
+  }
+  applyGainScalar(dst + i, gain, numSamples - i);
+}
+
+void addWithGainRampNeon(float* dst, const float* src, float startGain, float gainStep, size_t numSamples)
+{
+  const float32x4_t start = vdupq_n_f32(startGain);
+  const float indices[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  float32x4_t index = vld1q_f32(indices);
+  const float32x4_t four = vdupq_n_f32(4.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const float32x4_t g = vmlaq_n_f32(start, index, gainStep);
+    vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+    index = vaddq_f32(index, four);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * (startGain + gainStep * static_cast<float>(i));
+  }
+}
+
+void rampNeon(float* dst, float start, float step, size_t numSamples)
+{
+  const float32x4_t s = vdupq_n_f32(start);
+  const float indices[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  float32x4_t index = vld1q_f32(indices);
+  const float32x4_t four = vdupq_n_f32(4.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vmlaq_n_f32(s, index, step));
+    index = vaddq_f32(index, four);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = start + step * static_cast<float>(i);
+  }
+}
+
+void multiplyNeon(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+  }
+  multiplyScalar(dst + i, src + i, numSamples - i);
+}
+
+float sumOfSquaresNeon(const float* src, size_t numSamples)
+{
+  float32x4_t sum = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    const float32x4_t v = vld1q_f32(src + i);
+    sum = vmlaq_f32(sum, v, v);
+  }
+  float lanes[4];
+  vst1q_f32(lanes, sum);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumOfSquaresScalar(src + i, numSamples - i);
+}
+
+float peakNeon(const float* src, size_t numSamples)
+{
+  float32x4_t peak = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(src + i)));
+  }
+  float lanes[4];
+  vst1q_f32(lanes, peak);
+  float result = peakScalar(src + i, numSamples - i);
+  for (auto lane : lanes)
+  {
+    if (lane > result)
+    {
+      result = lane;
+    }
+  }
+  return result;
+}
+
+// a 4x4 transpose, out of two rounds of zips
+void transposeNeon(float32x4_t& r0, float32x4_t& r1, float32x4_t& r2, float32x4_t& r3)
+{
+  const float32x4x2_t t0 = vzipq_f32(r0, r2);
+  const float32x4x2_t t1 = vzipq_f32(r1, r3);
+  const float32x4x2_t u0 = vzipq_f32(t0.val[0], t1.val[0]);
+  const float32x4x2_t u1 = vzipq_f32(t0.val[1], t1.val[1]);
+  r0 = u0.val[0];
+  r1 = u0.val[1];
+  r2 = u1.val[0];
+  r3 = u1.val[1];
+}
+
+void interleaveNeon(float* dst, size_t frameSize, const float* src, size_t srcStride, size_t numChannels,
+                    size_t numSamples)
+{
+  if (frameSize == 2 && numChannels == 2)
+  {
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      float32x4x2_t v;
+      v.val[0] = vld1q_f32(src + s);
+      v.val[1] = vld1q_f32(src + srcStride + s);
+      vst2q_f32(dst + 2 * s, v);
+    }
+    interleaveScalar(dst + 2 * s, 2, src + s, srcStride, 2, numSamples - s);
+    return;
+  }
+
+  size_t c = 0;
+  for (; c + 4 <= numChannels; c += 4)
+  {
+    const float* s0 = src + c * srcStride;
+    float* d = dst + c;
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      float32x4_t r0 = vld1q_f32(s0 + s);
+      float32x4_t r1 = vld1q_f32(s0 + srcStride + s);
+      float32x4_t r2 = vld1q_f32(s0 + 2 * srcStride + s);
+      float32x4_t r3 = vld1q_f32(s0 + 3 * srcStride + s);
+      transposeNeon(r0, r1, r2, r3);
+      vst1q_f32(d + s * frameSize, r0);
+      vst1q_f32(d + (s + 1) * frameSize, r1);
+      vst1q_f32(d + (s + 2) * frameSize, r2);
+      vst1q_f32(d + (s + 3) * frameSize, r3);
+    }
+    interleaveScalar(dst + s * frameSize + c, frameSize, s0 + s, srcStride, 4, numSamples - s);
+  }
+  interleaveScalar(dst + c, frameSize, src + c * srcStride, srcStride, numChannels - c, numSamples);
+}
+
+void deinterleaveNeon(float* dst, size_t dstStride, const float* src, size_t frameSize, size_t numChannels,
+                      size_t numSamples)
+{
+  if (frameSize == 2 && numChannels == 2)
+  {
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      const float32x4x2_t v = vld2q_f32(src + 2 * s);
+      vst1q_f32(dst + s, v.val[0]);
+      vst1q_f32(dst + dstStride + s, v.val[1]);
+    }
+    deinterleaveScalar(dst + s, dstStride, src + 2 * s, 2, 2, numSamples - s);
+    return;
+  }
+
+  size_t c = 0;
+  for (; c + 4 <= numChannels; c += 4)
+  {
+    float* d0 = dst + c * dstStride;
+    const float* sPtr = src + c;
+    size_t s = 0;
+    for (; s + 4 <= numSamples; s += 4)
+    {
+      float32x4_t r0 = vld1q_f32(sPtr + s * frameSize);
+      float32x4_t r1 = vld1q_f32(sPtr + (s + 1) * frameSize);
+      float32x4_t r2 = vld1q_f32(sPtr + (s + 2) * frameSize);
+      float32x4_t r3 = vld1q_f32(sPtr + (s + 3) * frameSize);
+      transposeNeon(r0, r1, r2, r3);
+      vst1q_f32(d0 + s, r0);
+      vst1q_f32(d0 + dstStride + s, r1);
+      vst1q_f32(d0 + 2 * dstStride + s, r2);
+      vst1q_f32(d0 + 3 * dstStride + s, r3);
+    }
+    deinterleaveScalar(d0 + s, dstStride, src + s * frameSize + c, frameSize, 4, numSamples - s);
+  }
+  deinterleaveScalar(dst + c * dstStride, dstStride, src + c, frameSize, numChannels - c, numSamples);
+}
+
+// the fixed point conversions come from the scalar kernels
+const dc::AudioKernels neonKernels = {dc::AudioKernels::Isa::Neon, "neon", fillNeon, addNeon, addWithGainNeon,
+                                      copyWithGainNeon, applyGainNeon, addWithGainRampNeon, rampNeon,
+                                      multiplyNeon, nullptr, sumOfSquaresNeon, peakNeon, interleaveNeon, deinterleaveNeon,
+                                      nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+#endif
+
+bool cpuSupportsAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  // AVX2 and FMA, and the OS has to be saving the AVX registers
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+  {
+    return false;
+  }
+  __cpuid(info, 1);
+  const bool hasFma = (info[2] & (1 << 12)) != 0;
+  const bool hasOsXsave = (info[2] & (1 << 27)) != 0;
+  if (!hasFma || !hasOsXsave || (_xgetbv(0) & 6) != 6)
+  {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif
+}
+
+// fills in anything a set of kernels doesn't have its own version of
+dc::AudioKernels withFallback(dc::AudioKernels kernels, const dc::AudioKernels& fallback)
+{
+  auto fillIn = [](auto& kernel, auto fallbackKernel)
+  {
+    if (nullptr == kernel)
+    {
+      kernel = fallbackKernel;
+    }
+  };
+
+  fillIn(kernels.fill, fallback.fill);
+  fillIn(kernels.add, fallback.add);
+  fillIn(kernels.addWithGain, fallback.addWithGain);
+  fillIn(kernels.copyWithGain, fallback.copyWithGain);
+  fillIn(kernels.applyGain, fallback.applyGain);
+  fillIn(kernels.addWithGainRamp, fallback.addWithGainRamp);
+  fillIn(kernels.ramp, fallback.ramp);
+  fillIn(kernels.multiply, fallback.multiply);
+  fillIn(kernels.lookup, fallback.lookup);
+  fillIn(kernels.sumOfSquares, fallback.sumOfSquares);
+  fillIn(kernels.peak, fallback.peak);
+  fillIn(kernels.interleave, fallback.interleave);
+  fillIn(kernels.deinterleave, fallback.deinterleave);
+  fillIn(kernels.int16ToFloat, fallback.int16ToFloat);
+  fillIn(kernels.floatToInt16, fallback.floatToInt16);
+  fillIn(kernels.int24ToFloat, fallback.int24ToFloat);
+  fillIn(kernels.floatToInt24, fallback.floatToInt24);
+  fillIn(kernels.int32ToFloat, fallback.int32ToFloat);
+  fillIn(kernels.floatToInt32, fallback.floatToInt32);
+  return kernels;
+}
+
+const dc::AudioKernels& selectAudioKernels()
+{
+  for (auto isa : {dc::AudioKernels::Isa::Avx2, dc::AudioKernels::Isa::Neon, dc::AudioKernels::Isa::Sse2})
+  {
+    if (auto* kernels = dc::getAudioKernels(isa))
+    {
+      return *kernels;
+    }
+  }
+  return scalarKernels;
+}
+}
+
+const dc::AudioKernels& dc::getAudioKernels()
+{
+  static const AudioKernels& kernels = selectAudioKernels();
+  return kernels;
+}
+
+const dc::AudioKernels* dc::getAudioKernels(AudioKernels::Isa isa)
+{
+  switch (isa)
+  {
+    case AudioKernels::Isa::Scalar:
+      return &scalarKernels;
+
+    case AudioKernels::Isa::Sse2:
+    {
+#ifdef DC_KERNELS_SSE2
+      static const AudioKernels kernels = withFallback(sse2Kernels, scalarKernels);
+      return &kernels;
+#else
+      return nullptr;
+#endif
+    }
+
+    case AudioKernels::Isa::Avx2:
+    {
+      // anything that's not worth widening comes from SSE2, which every CPU with AVX2 has
+      auto* avx2Kernels = cpuSupportsAvx2() ? getAvx2AudioKernels() : nullptr;
+      if (nullptr == avx2Kernels)
+      {
+        return nullptr;
+      }
+      auto* sse2 = getAudioKernels(AudioKernels::Isa::Sse2);
+      static const AudioKernels kernels = withFallback(*avx2Kernels, nullptr != sse2 ? *sse2 : scalarKernels);
+      return &kernels;
+    }
+
+    case AudioKernels::Isa::Neon:
+    {
+#ifdef DC_KERNELS_NEON
+      static const AudioKernels kernels = withFallback(neonKernels, scalarKernels);
+      return &kernels;
+#else
+      return nullptr;
+#endif
+    }
+  }
+  return nullptr;
+}
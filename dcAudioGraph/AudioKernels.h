@@ -0,0 +1,99 @@
+/*
+ * The inner loops AudioBuffer and the graph run over channels of samples.
+ * There's a version for each instruction set we know about, and the best one the CPU supports
+ * is picked at runtime, the first time they're asked for.
+ * The scalar version is the reference the others are tested against.
+ * Channels in an AudioBuffer's own memory, and in the graph's buffers, start on a cache line.
+ * The kernels use unaligned loads anyway, which cost the same on aligned data, so they work on any pointer.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dc
+{
+struct AudioKernels final
+{
+  enum class Isa
+  {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon
+  };
+
+  Isa isa;
+  const char* name;
+
+  // dst[i] = value
+  void (*fill)(float* dst, float value, size_t numSamples);
+
+  // dst[i] += src[i]
+  void (*add)(float* dst, const float* src, size_t numSamples);
+
+  // dst[i] += src[i] * gain
+  void (*addWithGain)(float* dst, const float* src, float gain, size_t numSamples);
+
+  // dst[i] = src[i] * gain
+  void (*copyWithGain)(float* dst, const float* src, float gain, size_t numSamples);
+
+  // dst[i] *= gain
+  void (*applyGain)(float* dst, float gain, size_t numSamples);
+
+  // dst[i] += src[i] * (startGain + i * gainStep)
+  void (*addWithGainRamp)(float* dst, const float* src, float startGain, float gainStep, size_t numSamples);
+
+  // dst[i] = start + i * step
+  void (*ramp)(float* dst, float start, float step, size_t numSamples);
+
+  // dst[i] *= src[i]
+  void (*multiply)(float* dst, const float* src, size_t numSamples);
+
+  // Looks src[i] up in a table, with linear interpolation.
+  // The position in the table is src[i] * scale + offset, clamped to [0, tableSize - 1].
+  // table[tableSize] has to be there too, since the last point interpolates towards it.
+  void (*lookup)(float* dst, const float* src, const float* table, size_t tableSize, float scale, float offset,
+                 size_t numSamples);
+
+  // the sum of src[i] * src[i]
+  float (*sumOfSquares)(const float* src, size_t numSamples);
+
+  // the largest |src[i]|
+  float (*peak)(const float* src, size_t numSamples);
+
+  // Transposes between de-interleaved channels, srcStride/dstStride apart, and interleaved frames of frameSize samples.
+  // Only the first numChannels of each frame are touched.
+  // dst[s * frameSize + c] = src[c * srcStride + s]
+  void (*interleave)(float* dst, size_t frameSize, const float* src, size_t srcStride, size_t numChannels,
+                     size_t numSamples);
+
+  // dst[c * dstStride + s] = src[s * frameSize + c]
+  void (*deinterleave)(float* dst, size_t dstStride, const float* src, size_t frameSize, size_t numChannels,
+                       size_t numSamples);
+
+  // Fixed point conversions, where full scale is +/-1.
+  // Going to fixed point rounds to the nearest value and saturates.
+  // int24 is packed into 3 bytes, little-endian.
+  void (*int16ToFloat)(float* dst, const int16_t* src, size_t numSamples);
+
+  void (*floatToInt16)(int16_t* dst, const float* src, size_t numSamples);
+
+  void (*int24ToFloat)(float* dst, const uint8_t* src, size_t numSamples);
+
+  void (*floatToInt24)(uint8_t* dst, const float* src, size_t numSamples);
+
+  void (*int32ToFloat)(float* dst, const int32_t* src, size_t numSamples);
+
+  void (*floatToInt32)(int32_t* dst, const float* src, size_t numSamples);
+};
+
+// the best kernels this CPU supports
+const AudioKernels& getAudioKernels();
+
+// The kernels for a specific instruction set,
+// or nullptr if they aren't built for this platform or the CPU doesn't support them.
+// Anything an instruction set doesn't have its own version of comes from the next best one it implies.
+const AudioKernels* getAudioKernels(AudioKernels::Isa isa);
+}
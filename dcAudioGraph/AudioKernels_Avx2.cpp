@@ -0,0 +1,235 @@
+// This file is built with AVX2 and FMA turned on, and only gets called once the CPU says it supports them.
+// Keep it to intrinsics and plain loops: anything inline from a shared header could get built with AVX2 here,
+// and end up being the copy the linker keeps for everyone.
+
+#include "AudioKernels.h"
+
+namespace dc
+{
+const AudioKernels* getAvx2AudioKernels();
+}
+
+// MSVC's /arch:AVX2 brings FMA along with it, but doesn't say so
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+
+namespace
+{
+void fillAvx2(float* dst, float value, size_t numSamples)
+{
+  const __m256 v = _mm256_set1_ps(value);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, v);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = value;
+  }
+}
+
+void addAvx2(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] += src[i];
+  }
+}
+
+void addWithGainAvx2(float* dst, const float* src, float gain, size_t numSamples)
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g, _mm256_loadu_ps(dst + i)));
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * gain;
+  }
+}
+
+void copyWithGainAvx2(float* dst, const float* src, float gain, size_t numSamples)
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = src[i] * gain;
+  }
+}
+
+void applyGainAvx2(float* dst, float gain, size_t numSamples)
+{
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), g));
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] *= gain;
+  }
+}
+
+void addWithGainRampAvx2(float* dst, const float* src, float startGain, float gainStep, size_t numSamples)
+{
+  // the gain is worked out from the sample index each time, so it doesn't drift like a running sum would
+  const __m256 start = _mm256_set1_ps(startGain);
+  const __m256 step = _mm256_set1_ps(gainStep);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+  __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    const __m256 g = _mm256_fmadd_ps(step, index, start);
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), g, _mm256_loadu_ps(dst + i)));
+    index = _mm256_add_ps(index, eight);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] += src[i] * (startGain + gainStep * static_cast<float>(i));
+  }
+}
+
+void rampAvx2(float* dst, float start, float step, size_t numSamples)
+{
+  const __m256 s = _mm256_set1_ps(start);
+  const __m256 st = _mm256_set1_ps(step);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+  __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(s, _mm256_mul_ps(st, index)));
+    index = _mm256_add_ps(index, eight);
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = start + step * static_cast<float>(i);
+  }
+}
+
+void multiplyAvx2(float* dst, const float* src, size_t numSamples)
+{
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+  }
+  for (; i < numSamples; ++i)
+  {
+    dst[i] *= src[i];
+  }
+}
+
+void lookupAvx2(float* dst, const float* src, const float* table, size_t tableSize, float scale, float offset,
+                size_t numSamples)
+{
+  const float last = static_cast<float>(tableSize - 1);
+  const __m256 s = _mm256_set1_ps(scale);
+  const __m256 o = _mm256_set1_ps(offset);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 l = _mm256_set1_ps(last);
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    // max() returns its second argument for NaN, so those end up at the start of the table
+    const __m256 position = _mm256_min_ps(l, _mm256_max_ps(_mm256_fmadd_ps(_mm256_loadu_ps(src + i), s, o), zero));
+    const __m256i index = _mm256_cvttps_epi32(position);
+    const __m256 frac = _mm256_sub_ps(position, _mm256_cvtepi32_ps(index));
+    const __m256 lo = _mm256_i32gather_ps(table, index, 4);
+    const __m256 hi = _mm256_i32gather_ps(table + 1, index, 4);
+    _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_sub_ps(hi, lo), frac, lo));
+  }
+  for (; i < numSamples; ++i)
+  {
+    float position = src[i] * scale + offset;
+    position = position > 0.0f ? position : 0.0f;
+    position = position < last ? position : last;
+    const auto index = static_cast<int>(position);
+    const float frac = position - static_cast<float>(index);
+    dst[i] = table[index] + (table[index + 1] - table[index]) * frac;
+  }
+}
+
+float sumOfSquaresAvx2(const float* src, size_t numSamples)
+{
+  __m256 sum = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    const __m256 v = _mm256_loadu_ps(src + i);
+    sum = _mm256_fmadd_ps(v, v, sum);
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, sum);
+  float result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+  for (; i < numSamples; ++i)
+  {
+    result += src[i] * src[i];
+  }
+  return result;
+}
+
+float peakAvx2(const float* src, size_t numSamples)
+{
+  // clearing the sign bit is abs()
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  __m256 peak = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(src + i), absMask));
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, peak);
+  float result = 0.0f;
+  for (auto lane : lanes)
+  {
+    if (lane > result)
+    {
+      result = lane;
+    }
+  }
+  for (; i < numSamples; ++i)
+  {
+    const float val = src[i] < 0.0f ? -src[i] : src[i];
+    if (val > result)
+    {
+      result = val;
+    }
+  }
+  return result;
+}
+
+// the transposes and conversions come from SSE2
+const dc::AudioKernels avx2Kernels = {dc::AudioKernels::Isa::Avx2, "avx2", fillAvx2, addAvx2, addWithGainAvx2,
+                                      copyWithGainAvx2, applyGainAvx2, addWithGainRampAvx2, rampAvx2,
+                                      multiplyAvx2, lookupAvx2, sumOfSquaresAvx2, peakAvx2, nullptr, nullptr,
+                                      nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+}
+
+const dc::AudioKernels* dc::getAvx2AudioKernels()
+{
+  return &avx2Kernels;
+}
+#else
+// not an x86 build, or the compiler wasn't asked for AVX2
+const dc::AudioKernels* dc::getAvx2AudioKernels()
+{
+  return nullptr;
+}
+#endif
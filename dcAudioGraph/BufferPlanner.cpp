@@ -0,0 +1,139 @@
+#include "BufferPlanner.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+size_t dc::BufferPlanner::addBuffer(size_t size, size_t firstStep, size_t lastStep)
+{
+  _buffers.push_back({size, firstStep, std::max(firstStep, lastStep), 0});
+  _unpooledSize += size;
+  return _buffers.size() - 1;
+}
+
+size_t dc::BufferPlanner::plan()
+{
+  _free.clear();
+  _pooledSize = 0;
+
+  // go through the buffers in the order they're first needed
+  std::vector<size_t> byFirstStep(_buffers.size());
+  for (size_t i = 0; i < byFirstStep.size(); ++i)
+  {
+    byFirstStep[i] = i;
+  }
+  std::stable_sort(byFirstStep.begin(), byFirstStep.end(), [this](size_t a, size_t b)
+  {
+    return _buffers[a].firstStep < _buffers[b].firstStep;
+  });
+
+  // the buffers currently in use, soonest to be done with at the top
+  using LastStepAndIndex = std::pair<size_t, size_t>;
+  std::priority_queue<LastStepAndIndex, std::vector<LastStepAndIndex>, std::greater<LastStepAndIndex>> live;
+
+  for (auto index : byFirstStep)
+  {
+    auto& b = _buffers[index];
+
+    // anything that was last read before this buffer is written can give up its memory
+    while (!live.empty() && live.top().first < b.firstStep)
+    {
+      auto& done = _buffers[live.top().second];
+      release(done.offset, done.size);
+      live.pop();
+    }
+
+    if (b.size == 0)
+    {
+      b.offset = 0;
+      continue;
+    }
+
+    b.offset = allocate(b.size);
+    live.push({b.lastStep, index});
+  }
+
+  return _pooledSize;
+}
+
+size_t dc::BufferPlanner::getOffset(size_t index) const
+{
+  if (index < _buffers.size())
+  {
+    return _buffers[index].offset;
+  }
+  return 0;
+}
+
+size_t dc::BufferPlanner::getSize(size_t index) const
+{
+  if (index < _buffers.size())
+  {
+    return _buffers[index].size;
+  }
+  return 0;
+}
+
+void dc::BufferPlanner::clear()
+{
+  _buffers.clear();
+  _free.clear();
+  _pooledSize = 0;
+  _unpooledSize = 0;
+}
+
+size_t dc::BufferPlanner::allocate(size_t size)
+{
+  // first fit
+  for (size_t i = 0; i < _free.size(); ++i)
+  {
+    auto& r = _free[i];
+    if (r.size >= size)
+    {
+      const size_t offset = r.offset;
+      r.offset += size;
+      r.size -= size;
+      if (r.size == 0)
+      {
+        _free.erase(_free.begin() + i);
+      }
+      return offset;
+    }
+  }
+
+  // nothing fits, so grow the pool, starting from the last free range if it's at the end
+  size_t offset = _pooledSize;
+  if (!_free.empty() && _free.back().offset + _free.back().size == _pooledSize)
+  {
+    offset = _free.back().offset;
+    _free.pop_back();
+  }
+  _pooledSize = offset + size;
+  return offset;
+}
+
+void dc::BufferPlanner::release(size_t offset, size_t size)
+{
+  // keep the free list in order, and merge neighbouring ranges
+  auto it = std::lower_bound(_free.begin(), _free.end(), offset, [](const Range& r, size_t o)
+  {
+    return r.offset < o;
+  });
+  it = _free.insert(it, {offset, size});
+
+  auto next = it + 1;
+  if (next != _free.end() && it->offset + it->size == next->offset)
+  {
+    it->size += next->size;
+    _free.erase(next);
+  }
+
+  if (it != _free.begin())
+  {
+    auto prev = it - 1;
+    if (prev->offset + prev->size == it->offset)
+    {
+      prev->size += it->size;
+      _free.erase(it);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+/*
+ * Works out how a set of buffers can share one block of memory.
+ * Each buffer is only needed from the step where it's written to the last step that reads it,
+ * so buffers that are never needed at the same time can use the same memory.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace dc
+{
+class BufferPlanner final
+{
+public:
+  // Adds a buffer that's needed from firstStep to lastStep, inclusive.
+  // Returns the buffer's index, for getOffset().
+  size_t addBuffer(size_t size, size_t firstStep, size_t lastStep);
+
+  size_t getNumBuffers() const { return _buffers.size(); }
+
+  size_t getSize(size_t index) const;
+
+  // place the buffers, and return the total size they need
+  size_t plan();
+
+  // where a buffer starts, once plan() has been called
+  size_t getOffset(size_t index) const;
+
+  // the total size plan() came up with
+  size_t getPooledSize() const { return _pooledSize; }
+
+  // the total size if every buffer had its own memory
+  size_t getUnpooledSize() const { return _unpooledSize; }
+
+  void clear();
+
+private:
+  struct Buffer
+  {
+    size_t size;
+    size_t firstStep;
+    size_t lastStep;
+    size_t offset;
+  };
+
+  struct Range
+  {
+    size_t offset;
+    size_t size;
+  };
+
+  size_t allocate(size_t size);
+
+  void release(size_t offset, size_t size);
+
+  std::vector<Buffer> _buffers;
+  std::vector<Range> _free;
+  size_t _pooledSize = 0;
+  size_t _unpooledSize = 0;
+};
+}
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cmath>
+#include "AudioKernels.h"
+#include "CurveTable.h"
+
+namespace
+{
+// how many places between each pair of points to check the error at
+const size_t ERROR_CHECKS_PER_POINT = 8;
+}
+
+dc::CurveTable::CurveTable(const std::function<float(float)>& curve, float start, float end, size_t numPoints) :
+    _start(start),
+    _end(end),
+    _numPoints(std::max(size_t(2), numPoints))
+{
+  const double step = (static_cast<double>(_end) - _start) / (_numPoints - 1);
+  _scale = static_cast<float>(1.0 / step);
+  _offset = static_cast<float>(-_start / step);
+
+  _points.resize(_numPoints + 1);
+  for (size_t i = 0; i < _numPoints; ++i)
+  {
+    _points[i] = curve(static_cast<float>(_start + step * i));
+  }
+  _points[_numPoints] = _points[_numPoints - 1];
+
+  // compare against the curve between the points, where the interpolation is furthest off
+  for (size_t i = 0; i + 1 < _numPoints; ++i)
+  {
+    for (size_t j = 1; j < ERROR_CHECKS_PER_POINT; ++j)
+    {
+      const auto x = static_cast<float>(_start + step * (i + static_cast<double>(j) / ERROR_CHECKS_PER_POINT));
+      const float error = std::abs(lookup(x) - curve(x));
+      if (std::isfinite(error))
+      {
+        _maxError = std::max(_maxError, error);
+      }
+    }
+  }
+}
+
+float dc::CurveTable::lookup(float x) const
+{
+  float out;
+  lookup(&x, &out, 1);
+  return out;
+}
+
+void dc::CurveTable::lookup(const float* xs, float* out, size_t numValues) const
+{
+  getAudioKernels().lookup(out, xs, _points.data(), _numPoints, _scale, _offset, numValues);
+}
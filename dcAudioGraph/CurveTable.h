@@ -0,0 +1,48 @@
+/*
+ * A curve sampled into a table, and read back with linear interpolation.
+ * For conversions that are too expensive to compute for every sample, like pow() or exp().
+ * How far the table is off from the real curve is measured when it's built, see getMaxError().
+ * Lookups outside the range the table covers clamp to its ends.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace dc
+{
+class CurveTable final
+{
+public:
+  // Samples curve at numPoints evenly spaced points from start to end.
+  // It needs at least 2 points, and start and end can't be the same.
+  CurveTable(const std::function<float(float)>& curve, float start, float end, size_t numPoints);
+
+  float lookup(float x) const;
+
+  // lookup() for a block of values, which can be converted in place
+  void lookup(const float* xs, float* out, size_t numValues) const;
+
+  // The largest difference between a lookup and the real curve.
+  // It's measured between the points when the table is built, so it's exact for all practical purposes.
+  float getMaxError() const { return _maxError; }
+
+  float getStart() const { return _start; }
+
+  float getEnd() const { return _end; }
+
+  size_t getNumPoints() const { return _numPoints; }
+
+private:
+  float _start;
+  float _end;
+  size_t _numPoints;
+  float _scale;
+  float _offset;
+  float _maxError = 0.0f;
+  // with a copy of the last point on the end, so interpolating from it doesn't need a special case
+  std::vector<float> _points;
+};
+}
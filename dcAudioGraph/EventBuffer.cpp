@@ -1,11 +1,12 @@
 #include "EventBuffer.h"
+#include <algorithm>
 
 dc::EventMessage::EventMessage() : type(Type::Trigger), sampleOffset(0)
 {
   noParam = 0;
 }
 
-dc::EventMessage::EventMessage(Type type, size_t sampleOffset) : sampleOffset(sampleOffset)
+dc::EventMessage::EventMessage(Type type, uint32_t sampleOffset) : sampleOffset(sampleOffset)
 {
   // ensure a valid type is used
   switch (type)
@@ -35,11 +36,11 @@ dc::EventBuffer::Channel::Iterator::Iterator(Channel& channel) : _channel(channe
 
 bool dc::EventBuffer::Channel::Iterator::next(EventMessage& messageOut)
 {
-  if (_channel._messages.empty() || _next >= _channel._messages.size())
+  if (_next >= _channel._size)
   {
     return false;
   }
-  messageOut = _channel._messages[_next++];
+  messageOut = _channel._data[_next++];
   return true;
 }
 
@@ -47,45 +48,207 @@ dc::EventBuffer::Channel::Iterator::Iterator() : _channel(_invalidChannel)
 {
 }
 
-dc::EventBuffer::Channel::Channel()
+dc::EventBuffer::Channel::Channel(const Channel& other)
 {
-  // try to avoid re-allocations in the process chain
-  // TODO: this should be configurable somewhere
-  _messages.reserve(1024);
+  *this = other;
 }
 
-void dc::EventBuffer::Channel::insert(EventMessage& message)
+dc::EventBuffer::Channel::Channel(Channel&& other) noexcept
 {
-  // keep the buffer in order of sample offset
-  // TODO: faster insert, in case this gets used for large numbers of messages
-  for (auto it = _messages.begin(); it != _messages.end(); ++it)
+  *this = std::move(other);
+}
+
+dc::EventBuffer::Channel& dc::EventBuffer::Channel::operator=(const Channel& other)
+{
+  if (this != &other)
+  {
+    _size = 0;
+    reserve(other._size);
+    std::copy(other._data, other._data + other._size, _data);
+    _size = other._size;
+  }
+  return *this;
+}
+
+dc::EventBuffer::Channel& dc::EventBuffer::Channel::operator=(Channel&& other) noexcept
+{
+  if (this != &other)
+  {
+    // moving the vector keeps its memory where it is, so _data stays good either way
+    _ownStorage = std::move(other._ownStorage);
+    _data = other._data;
+    _size = other._size;
+    _capacity = other._capacity;
+    _overflowCounter = other._overflowCounter;
+    _isPooled = other._isPooled;
+    other._ownStorage.clear();
+    other._data = nullptr;
+    other._size = 0;
+    other._capacity = 0;
+    other._overflowCounter = nullptr;
+    other._isPooled = false;
+  }
+  return *this;
+}
+
+void dc::EventBuffer::Channel::setExternalStorage(EventMessage* data, size_t capacity,
+                                                  std::atomic<size_t>* overflowCounter)
+{
+  _ownStorage = std::vector<EventMessage>();
+  _data = data;
+  _size = 0;
+  _capacity = nullptr != data ? capacity : 0;
+  _overflowCounter = overflowCounter;
+  _isPooled = nullptr != data;
+}
+
+void dc::EventBuffer::Channel::reserve(size_t numMessages)
+{
+  if (numMessages <= _capacity)
+  {
+    return;
+  }
+
+  std::vector<EventMessage> storage(numMessages);
+  std::copy(_data, _data + _size, storage.begin());
+  _ownStorage.swap(storage);
+  _data = _ownStorage.data();
+  _capacity = _ownStorage.size();
+}
+
+size_t dc::EventBuffer::Channel::makeRoom(size_t numMessages)
+{
+  if (numMessages <= _capacity)
+  {
+    return numMessages;
+  }
+
+  // pooled channels are used on the audio thread, so they make do with what they have
+  if (_isPooled)
+  {
+    return _capacity;
+  }
+
+  const size_t minCapacity = 16;
+  reserve(std::max(numMessages, std::max(minCapacity, _capacity * 2)));
+  return numMessages;
+}
+
+void dc::EventBuffer::Channel::countDropped(size_t numMessages)
+{
+  if (nullptr != _overflowCounter)
+  {
+    _overflowCounter->fetch_add(numMessages, std::memory_order_relaxed);
+  }
+}
+
+void dc::EventBuffer::Channel::insert(const EventMessage& message)
+{
+  // the usual case, appending in order with room to spare
+  if (_size < _capacity && (_size == 0 || _data[_size - 1].sampleOffset <= message.sampleOffset))
   {
-    if (message.sampleOffset <= it->sampleOffset)
+    _data[_size++] = message;
+    return;
+  }
+
+  // it could be one of ours, which makeRoom() could move
+  const EventMessage msg = message;
+  if (makeRoom(_size + 1) <= _size)
+  {
+    // full, so whichever is latest goes
+    countDropped(1);
+    if (_size == 0 || _data[_size - 1].sampleOffset <= msg.sampleOffset)
     {
-      _messages.insert(it, message);
       return;
     }
+    --_size;
   }
-  // the message list was empty, or this should be the last element
-  _messages.push_back(message);
+
+  if (_size == 0 || _data[_size - 1].sampleOffset <= msg.sampleOffset)
+  {
+    _data[_size++] = msg;
+    return;
+  }
+
+  // after everything at the same offset
+  auto* it = std::upper_bound(_data, _data + _size, msg,
+                              [](const EventMessage& a, const EventMessage& b)
+                              {
+                                return a.sampleOffset < b.sampleOffset;
+                              });
+  std::copy_backward(it, _data + _size, _data + _size + 1);
+  *it = msg;
+  ++_size;
 }
 
-void dc::EventBuffer::Channel::merge(Channel& other)
+void dc::EventBuffer::Channel::merge(const Channel& other, EventMessage::Type typeFilter)
 {
-  Iterator otherIt(other);
-  EventMessage msg;
-  while (otherIt.next(msg))
+  if (&other == this)
+  {
+    return;
+  }
+
+  size_t numToMerge = 0;
+  for (size_t i = 0; i < other._size; ++i)
+  {
+    if (eventMessageTypeMatches(typeFilter, other._data[i].type))
+    {
+      ++numToMerge;
+    }
+  }
+  if (numToMerge == 0)
+  {
+    return;
+  }
+
+  // Both channels are already in order, so merge them from the back, in place.
+  // Ties go to the other channel's message, which puts it after ours.
+  // Whatever lands past the room there is gets dropped, which keeps the earliest messages.
+  const size_t numMerged = _size + numToMerge;
+  const size_t numKept = makeRoom(numMerged);
+  size_t ours = _size;
+  size_t theirs = other._size;
+  size_t out = numMerged;
+  while (theirs > 0)
+  {
+    const auto& msg = other._data[theirs - 1];
+    if (!eventMessageTypeMatches(typeFilter, msg.type))
+    {
+      --theirs;
+    }
+    else if (ours > 0 && _data[ours - 1].sampleOffset > msg.sampleOffset)
+    {
+      if (--out < numKept)
+      {
+        _data[out] = _data[ours - 1];
+      }
+      --ours;
+    }
+    else
+    {
+      if (--out < numKept)
+      {
+        _data[out] = msg;
+      }
+      --theirs;
+    }
+  }
+  _size = numKept;
+
+  if (numKept < numMerged)
   {
-    insert(msg);
+    countDropped(numMerged - numKept);
   }
 }
 
 void dc::EventBuffer::Channel::clear()
 {
-  _messages.clear();
+  _size = 0;
 }
 
-void dc::EventBuffer::setNumChannels(size_t numChannels)
+const size_t dc::EventBuffer::DEFAULT_CHANNEL_CAPACITY;
+
+void dc::EventBuffer::setNumChannels(size_t numChannels, size_t channelCapacity)
 {
   while (numChannels < _channels.size())
   {
@@ -95,6 +258,10 @@ void dc::EventBuffer::setNumChannels(size_t numChannels)
   {
     _channels.emplace_back();
   }
+  for (auto& channel : _channels)
+  {
+    channel.reserve(channelCapacity);
+  }
 }
 
 size_t dc::EventBuffer::getNumMessages(size_t channelIndex)
@@ -106,6 +273,15 @@ size_t dc::EventBuffer::getNumMessages(size_t channelIndex)
   return 0;
 }
 
+dc::EventBuffer::Channel* dc::EventBuffer::getChannel(size_t channelIndex)
+{
+  if (channelIndex < _channels.size())
+  {
+    return &_channels[channelIndex];
+  }
+  return nullptr;
+}
+
 dc::EventBuffer::Channel::Iterator dc::EventBuffer::getIterator(size_t channelIdx)
 {
   if (channelIdx < _channels.size())
@@ -115,7 +291,7 @@ dc::EventBuffer::Channel::Iterator dc::EventBuffer::getIterator(size_t channelId
   return Channel::Iterator::invalid;
 }
 
-void dc::EventBuffer::insert(EventMessage& message, size_t channelIndex)
+void dc::EventBuffer::insert(const EventMessage& message, size_t channelIndex)
 {
   if (channelIndex < _channels.size())
   {
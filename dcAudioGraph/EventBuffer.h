@@ -4,13 +4,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace dc
 {
 // A single message
 // This can be a trigger or a MIDI-style note
+// Kept to 16 bytes, so four of them fit on a cache line.
 struct EventMessage final
 {
   // Specifies the type of the message.
@@ -38,10 +41,10 @@ struct EventMessage final
 
   EventMessage();
 
-  explicit EventMessage(Type type, size_t sampleOffset);
+  explicit EventMessage(Type type, uint32_t sampleOffset);
 
   Type type;
-  size_t sampleOffset;
+  uint32_t sampleOffset;
 
   union
   {
@@ -51,6 +54,8 @@ struct EventMessage final
   };
 };
 
+static_assert(sizeof(EventMessage) == 16, "EventMessage should stay compact");
+
 constexpr EventMessage::Type operator|(const EventMessage::Type lhs, const EventMessage::Type rhs)
 {
   return static_cast<EventMessage::Type>(static_cast<uint16_t>(lhs) | static_cast<uint16_t>(rhs));
@@ -73,6 +78,7 @@ public:
   class Channel final
   {
   public:
+    // copies each message out, see begin() and end() to read them in place
     class Iterator final
     {
     public:
@@ -91,31 +97,86 @@ public:
       size_t _next = 0;
     };
 
-    explicit Channel();
+    Channel() = default;
+
+    Channel(const Channel& other);
+
+    Channel(Channel&& other) noexcept;
+
+    Channel& operator=(const Channel& other);
+
+    Channel& operator=(Channel&& other) noexcept;
+
+    size_t size() const { return _size; };
+
+    // how many messages fit before the channel has to allocate more memory, or drop them if it's pooled
+    size_t capacity() const { return _capacity; }
 
-    size_t size() const { return _messages.size(); };
+    // Makes room for at least this many messages, in memory of the channel's own if it needs more.
+    // This allocates, so do it before handing the channel to the audio thread.
+    void reserve(size_t numMessages);
+
+    // Hands the channel memory it doesn't own, like its share of a graph's event pool, and drops its messages.
+    // Adding to it never allocates after that: when it's full, the latest messages are dropped,
+    // and each one dropped adds to overflowCounter if there is one. Passing nullptr data makes it a channel of its own again.
+    void setExternalStorage(EventMessage* data, size_t capacity, std::atomic<size_t>* overflowCounter);
 
     Iterator getIterator() { return Iterator(*this); }
 
-    void insert(EventMessage& message);
+    // The messages, in order, where they are.
+    // These stay good until the channel is changed.
+    const EventMessage* begin() const { return _data; }
+
+    const EventMessage* end() const { return _data + _size; }
+
+    const EventMessage& operator[](size_t index) const { return _data[index]; }
 
-    void merge(Channel& other);
+    // Keeps the messages in order of sample offset.
+    // Messages at the same offset stay in the order they were added.
+    // Appending in order, which is the usual case, doesn't have to look at the rest.
+    // A full pooled channel keeps the earliest messages, so this can drop the message or the last one already here.
+    void insert(const EventMessage& message);
+
+    // Adds the messages from another channel that match typeFilter, in one pass over both,
+    // after any messages already here at the same offsets.
+    // A pooled channel keeps as many of the earliest as fit.
+    void merge(const Channel& other, EventMessage::Type typeFilter = EventMessage::All);
 
     void clear();
 
   private:
-    std::vector<EventMessage> _messages;
+    // Makes room for adding messages, growing geometrically if the channel has memory of its own.
+    // A pooled channel can't grow on the audio thread, so this returns how many fit, which can be fewer.
+    size_t makeRoom(size_t numMessages);
+
+    void countDropped(size_t numMessages);
+
+    // either external storage, or _ownStorage
+    EventMessage* _data = nullptr;
+    size_t _size = 0;
+    size_t _capacity = 0;
+    std::vector<EventMessage> _ownStorage;
+    std::atomic<size_t>* _overflowCounter = nullptr;
+    bool _isPooled = false;
   };
 
+  static const size_t DEFAULT_CHANNEL_CAPACITY = 64;
+
   size_t getNumChannels() const { return _channels.size(); }
 
-  void setNumChannels(size_t numChannels);
+  // Every channel gets room for at least channelCapacity messages.
+  // The buffer you pass to Graph::process() gets the graph's input events and its output events,
+  // so make it big enough for the most of either you expect in a block, and it won't allocate on the audio thread.
+  void setNumChannels(size_t numChannels, size_t channelCapacity = DEFAULT_CHANNEL_CAPACITY);
 
   size_t getNumMessages(size_t channelIndex);
 
+  // returns nullptr if the channel doesn't exist
+  Channel* getChannel(size_t channelIndex);
+
   Channel::Iterator getIterator(size_t channelIdx);
 
-  void insert(EventMessage& message, size_t channelIndex);
+  void insert(const EventMessage& message, size_t channelIndex);
 
   void merge(EventBuffer& from);
 
@@ -1,26 +1,53 @@
 #include "Gain.h"
 #include <cmath>
+#include "AudioKernels.h"
 
 dc::Gain::Gain()
 {
   setNumIo(Audio | Input | Output, 1);
-  addParam("gain", "Gain", ParamRange(-70.0f, 0.0f, 0.0f, getNormalized, getRaw, 2.0f), true, true, 1.0f);
+  // silence in, silence out
+  setTailLength(0);
+  addParam("gain", "Gain", getGainRange(), true, true, 1.0f);
 }
 
 void dc::Gain::process(ModuleProcessContext& context)
 {
   updateParams(context);
 
-  const size_t nChannels = context.audioBuffer.getNumChannels();
-  const size_t nSamples = context.audioBuffer.getNumSamples();
+  auto& audio = context.audioBuffer;
+  const size_t nChannels = audio.getNumChannels();
+  const size_t nSamples = audio.getNumSamples();
+  const auto& kernels = getAudioKernels();
+  auto* param = context.params[0];
+
+  // a steady gain is one multiply for every sample, and unity gain is nothing at all
+  if (!param->isSmoothing())
+  {
+    const float gain = param->getRange().getValue(param->getSmoothedRaw(0));
+    if (gain == 1.0f)
+    {
+      return;
+    }
+
+    for (size_t cIdx = 0; cIdx < nChannels; ++cIdx)
+    {
+      if (!audio.isSilent(cIdx))
+      {
+        kernels.applyGain(audio.getChannelPointer(cIdx), gain, nSamples);
+      }
+    }
+    return;
+  }
+
+  // otherwise work out the gain for the block once, and share it between the channels
+  float* gain = getSmoothedParam(context, 0);
+  param->getRange().getValue(gain, gain, nSamples);
 
   for (size_t cIdx = 0; cIdx < nChannels; ++cIdx)
   {
-    auto* audPtr = context.audioBuffer.getChannelPointer(cIdx);
-    for (size_t sIdx = 0; sIdx < nSamples; ++sIdx)
+    if (!audio.isSilent(cIdx))
     {
-      const float gainDb = context.params[0]->getSmoothedRaw(sIdx);
-      audPtr[sIdx] *= dbToLin(gainDb);
+      kernels.multiply(audio.getChannelPointer(cIdx), gain, nSamples);
     }
   }
 }
@@ -41,3 +68,11 @@ float dc::Gain::dbToLin(float db)
 {
   return powf(10.0f, db / 20.0f);
 }
+
+const dc::ParamRange& dc::Gain::getGainRange()
+{
+  static ParamRange range(-70.0f, 0.0f, 0.0f, getNormalized, getRaw, 2.0f);
+  static const bool haveTables = (range.buildTables(ParamRange::DEFAULT_TABLE_SIZE, dbToLin), true);
+  (void)haveTables;
+  return range;
+}
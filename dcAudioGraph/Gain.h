@@ -21,5 +21,8 @@ private:
   static float getRaw(float normalizedValue, float min, float max);
 
   static float dbToLin(float db);
+
+  // the gain curve, with its tables built once and shared by every Gain
+  static const ParamRange& getGainRange();
 };
 }
@@ -1,6 +1,87 @@
 #include "Graph.h"
 #include <algorithm>
-#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include "AudioKernels.h"
+#include "BufferPlanner.h"
+
+namespace
+{
+bool hasEvents(dc::EventBuffer& events)
+{
+  for (size_t cIdx = 0; cIdx < events.getNumChannels(); ++cIdx)
+  {
+    if (events.getNumMessages(cIdx) > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+}
+
+// Hands modules out to the worker pool as their inputs become ready.
+// Each thread works through its own queue, then steals from the others.
+class dc::Graph::ParallelProcessJob final : public WorkerPool::Job
+{
+public:
+  explicit ParallelProcessJob(GraphProcessContext& context) : _context(context) {}
+
+  void work(size_t workerIndex) override
+  {
+    auto& queues = _context.queues;
+    if (workerIndex >= queues.size())
+    {
+      return;
+    }
+
+    auto& ownQueue = *queues[workerIndex];
+    size_t spins = 0;
+
+    while (_context.numRemaining.load(std::memory_order_acquire) > 0)
+    {
+      size_t moduleIdx = 0;
+      if (ownQueue.pop(moduleIdx) || steal(workerIndex, moduleIdx))
+      {
+        auto& m = _context.modules[moduleIdx];
+        const auto* program = _context.program.data();
+        runProgram(program + m.firstOp, program + m.endOp);
+
+        for (auto dependentIdx : m.dependents)
+        {
+          if (_context.numPendingInputs[dependentIdx].fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            ownQueue.push(dependentIdx);
+          }
+        }
+
+        _context.numRemaining.fetch_sub(1, std::memory_order_release);
+        spins = 0;
+      }
+      else
+      {
+        WorkerPool::backoff(spins);
+      }
+    }
+  }
+
+private:
+  bool steal(size_t workerIndex, size_t& moduleIdx)
+  {
+    auto& queues = _context.queues;
+    for (size_t i = 1; i < queues.size(); ++i)
+    {
+      if (queues[(workerIndex + i) % queues.size()]->steal(moduleIdx))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  GraphProcessContext& _context;
+};
 
 bool dc::Connection::operator==(const Connection& other) const
 {
@@ -14,7 +95,10 @@ bool dc::Connection::operator==(const Connection& other) const
 dc::Graph::Graph()
 {
   _inputModule._id = 1;
+  _inputModule._graph = this;
   _outputModule._id = 2;
+  _outputModule._graph = this;
+  _pendingParamChanges.reserve(PARAM_CHANGE_QUEUE_SIZE);
   updateGraphProcessContext();
 }
 
@@ -25,8 +109,11 @@ void dc::Graph::process(ModuleProcessContext& context)
 
 void dc::Graph::process(AudioBuffer& audio, EventBuffer& events) const
 {
+  // let edits know when we're done with what we're about to look at
+  Reclaimer::Scope reclaimerScope(_reclaimer);
+
   // get the context
-  auto context = std::atomic_load(&_graphProcessContext);
+  auto* context = _graphProcessContext.load();
 
   // this could be valid, so handle it
   if (nullptr == context || context->modules.empty())
@@ -35,11 +122,11 @@ void dc::Graph::process(AudioBuffer& audio, EventBuffer& events) const
   }
 
   // copy input to input module
-  if (auto* input = context->modules[0].module)
+  if (auto* mCtx = context->modules[0].context)
   {
-    auto mCtx = std::atomic_load(&input->_processContext);
-
-    // clear in case there are different numbers of channels
+    // clear in case there are different numbers of channels, forgetting the flags first
+    // since other modules may have used this memory since the last block
+    mCtx->audioBuffer.getWritableData();
     mCtx->audioBuffer.zero();
     mCtx->eventBuffer.clear();
 
@@ -48,21 +135,26 @@ void dc::Graph::process(AudioBuffer& audio, EventBuffer& events) const
   }
   else
   {
-    assert(false);
     return;
   }
 
+  const size_t blockSize = context->modules[0].context->blockSize;
+  applyParamChanges(*context, blockSize);
+
   // process the modules
-  for (auto& m : context->modules)
+  if (nullptr != context->workerPool)
   {
-    processModule(m);
+    processModulesParallel(*context);
+  }
+  else
+  {
+    const auto* program = context->program.data();
+    runProgram(program, program + context->program.size());
   }
 
   // copy output from output module
-  if (auto* output = context->modules[context->modules.size() - 1].module)
+  if (auto* mCtx = context->modules[context->modules.size() - 1].context)
   {
-    auto mCtx = std::atomic_load(&output->_processContext);
-
     // clear in case there are different numbers of channels
     audio.zero();
     events.clear();
@@ -70,131 +162,727 @@ void dc::Graph::process(AudioBuffer& audio, EventBuffer& events) const
     audio.copyFrom(mCtx->audioBuffer, false);
     events.merge(mCtx->eventBuffer);
   }
-  else
-  {
-    assert(false);
-  }
+
+  _sampleTime.store(_sampleTime.load(std::memory_order_relaxed) + blockSize, std::memory_order_release);
 }
 
-void dc::Graph::processModule(ModuleRenderInfo& m)
+bool dc::Graph::postParamChange(size_t moduleId, size_t paramIndex, float rawValue, uint64_t sampleTime)
 {
-  assert(nullptr != m.module);
+  return _paramChanges.push({moduleId, paramIndex, rawValue, sampleTime});
+}
 
-  auto ctx = std::atomic_load(&m.module->_processContext);
+void dc::Graph::applyParamChanges(const GraphProcessContext& context, size_t blockSize) const
+{
+  auto& pending = _pendingParamChanges;
+  auto byTime = [](const ParamChange& a, const ParamChange& b)
+  {
+    return a.sampleTime < b.sampleTime;
+  };
 
-  if (nullptr == ctx)
+  // Take in what's been posted, in order of time, and in the order they were posted for the same time.
+  // There's only room for so many, so anything past that waits in the queue.
+  ParamChange change{};
+  while (pending.size() < pending.capacity() && _paramChanges.pop(change))
   {
-    return;
+    if (pending.empty() || pending.back().sampleTime <= change.sampleTime)
+    {
+      pending.push_back(change);
+    }
+    else
+    {
+      pending.insert(std::upper_bound(pending.begin(), pending.end(), change, byTime), change);
+    }
   }
 
-  // if this module has inputs, pull in the input data
-  if (ctx->numAudioIn > 0 || ctx->numEventIn > 0)
+  const uint64_t blockStart = _sampleTime.load(std::memory_order_relaxed);
+  const uint64_t blockEnd = blockStart + blockSize;
+  size_t numDue = 0;
+  for (; numDue < pending.size() && pending[numDue].sampleTime < blockEnd; ++numDue)
   {
-    ctx->audioBuffer.zero();
-    ctx->eventBuffer.clear();
-
-    for (auto inputInfo : m.inputs)
+    const auto& c = pending[numDue];
+    auto target = std::lower_bound(context.paramTargets.begin(), context.paramTargets.end(), c.moduleId,
+                                   [](const ParamTarget& t, size_t id)
+                                   {
+                                     return t.moduleId < id;
+                                   });
+    if (target != context.paramTargets.end() && target->moduleId == c.moduleId && c.paramIndex < target->params.size())
     {
-      auto inCtx = std::atomic_load(&inputInfo.module->_processContext);
-
-      if (nullptr == inCtx)
+      const size_t offset = c.sampleTime > blockStart ? static_cast<size_t>(c.sampleTime - blockStart) : 0;
+      auto* param = target->params[c.paramIndex];
+      param->scheduleRaw(offset, c.rawValue);
+      if (!target->isProcessed)
       {
-        continue;
+        param->skipBlock();
       }
+    }
+  }
+  pending.erase(pending.begin(), pending.begin() + numDue);
+}
+
+void dc::Graph::runProgram(const RenderOp* op, const RenderOp* end)
+{
+  const auto& kernels = getAudioKernels();
 
-      switch (inputInfo.type)
+  for (; op != end; ++op)
+  {
+    switch (op->type)
+    {
+      case RenderOp::Type::ForgetSilence:
+        std::fill(op->silence.flags, op->silence.flags + op->silence.numChannels, false);
+        break;
+      case RenderOp::Type::Zero:
+      {
+        auto& args = op->audio;
+        if (!*args.toSilent)
+        {
+          memset(args.to, 0, args.numSamples * sizeof(float));
+          *args.toSilent = true;
+        }
+        break;
+      }
+      case RenderOp::Type::CopyChannel:
+      {
+        // copies always fill the whole channel
+        auto& args = op->audio;
+        if (!*args.fromSilent)
+        {
+          memcpy(args.to, args.from, args.numSamples * sizeof(float));
+          *args.toSilent = false;
+        }
+        else if (!*args.toSilent)
+        {
+          memset(args.to, 0, args.numSamples * sizeof(float));
+          *args.toSilent = true;
+        }
+        break;
+      }
+      case RenderOp::Type::AddChannel:
       {
-        case Connection::Type::Audio:
-          ctx->audioBuffer.addFrom(inCtx->audioBuffer, inputInfo.fromIdx, inputInfo.toIdx);
+        // adding silence doesn't change anything, and adding to silence is just a copy
+        auto& args = op->audio;
+        if (*args.fromSilent)
+        {
           break;
-        case Connection::Type::Event:
+        }
+        if (*args.toSilent)
+        {
+          memcpy(args.to, args.from, args.numSamples * sizeof(float));
+        }
+        else
+        {
+          kernels.add(args.to, args.from, args.numSamples);
+        }
+        *args.toSilent = false;
+        break;
+      }
+      case RenderOp::Type::ClearEvents:
+        op->events.to->clear();
+        break;
+      case RenderOp::Type::RouteEvents:
+        op->events.to->merge(*op->events.from, op->events.typeFlags);
+        break;
+      case RenderOp::Type::Process:
+      {
+        auto& args = op->process;
+        if (nullptr != args.numSilentSamples)
         {
-          auto it = inCtx->eventBuffer.getIterator(inputInfo.fromIdx);
-          EventMessage msg;
-          while (it.next(msg))
+          // once the input has been silent for longer than the module's tail, its output is silent too,
+          // and that's what's already in the buffer
+          if (args.context->audioBuffer.isSilent() && !hasEvents(args.context->eventBuffer))
           {
-            if (eventMessageTypeMatches(inputInfo.eventTypeFlags, msg.type))
+            // stop counting once we're past the tail, so it can't wrap around
+            if (*args.numSilentSamples <= args.context->tailLength)
             {
-              ctx->eventBuffer.insert(msg, inputInfo.toIdx);
+              *args.numSilentSamples += args.context->blockSize;
+            }
+            if (*args.numSilentSamples > args.context->tailLength)
+            {
+              for (auto* param : args.context->params)
+              {
+                param->skipBlock();
+              }
+              break;
             }
           }
+          else
+          {
+            *args.numSilentSamples = 0;
+          }
         }
-          break;
-        default:;
+        args.module->process(*args.context);
+        break;
       }
+      default:;
+    }
+  }
+}
+
+void dc::Graph::processModulesParallel(GraphProcessContext& context)
+{
+  const size_t numModules = context.modules.size();
+
+  // nobody else is touching the queues between jobs, so set everything up from here
+  for (auto& q : context.queues)
+  {
+    q->reset();
+  }
+
+  size_t nextQueue = 0;
+  for (size_t i = 0; i < numModules; ++i)
+  {
+    const size_t numDependencies = context.modules[i].numDependencies;
+    context.numPendingInputs[i].store(numDependencies, std::memory_order_relaxed);
+    if (numDependencies == 0)
+    {
+      context.queues[nextQueue]->push(i);
+      nextQueue = (nextQueue + 1) % context.queues.size();
     }
   }
+  context.numRemaining.store(numModules, std::memory_order_release);
 
-  m.module->process(*ctx);
+  ParallelProcessJob job(context);
+  context.workerPool->run(job);
 }
 
 void dc::Graph::updateGraphProcessContext()
 {
+  // wait for the edit to finish
+  if (isEditing() || _applyingDeferredEdits)
+  {
+    _graphProcessContextDirty = true;
+    return;
+  }
+  _graphProcessContextDirty = false;
+
   auto newContext = std::make_shared<GraphProcessContext>();
 
-  // build the context
-  newContext->modules.push_back(makeModuleRenderInfo(_inputModule));
+  // everything in the order it's processed in, with the graph's input first and its output last
+  // modules that don't feed the output or a module with side effects can't be heard, so they're left out
+  std::vector<size_t> order;
+  _topology.getLiveOrder(order);
+
+  std::vector<Module*> schedule;
+  schedule.reserve(order.size() + 2);
+  schedule.push_back(&_inputModule);
+  for (auto id : order)
+  {
+    schedule.push_back(_modules[_moduleIndices[id]].get());
+  }
+  schedule.push_back(&_outputModule);
+
+  // param changes go to every module, so their values are right when they're processed again
   for (auto& m : _modules)
   {
-    size_t insertIdx = 0;
-    for (; insertIdx < newContext->modules.size(); ++insertIdx)
+    if (nullptr != m->_processContext)
     {
-      if (moduleIsInputTo(m.get(), newContext->modules[insertIdx].module))
+      newContext->paramTargets.push_back({m->getId(), m->_processContext->params, _topology.isLive(m->getId())});
+    }
+  }
+  std::sort(newContext->paramTargets.begin(), newContext->paramTargets.end(),
+            [](const ParamTarget& a, const ParamTarget& b)
+            {
+              return a.moduleId < b.moduleId;
+            });
+
+  // give every module a context of its own, that stays put for as long as this graph context is around
+  std::unordered_map<size_t, size_t> stepsById;
+  newContext->moduleContexts.reserve(schedule.size());
+  for (size_t i = 0; i < schedule.size(); ++i)
+  {
+    stepsById[schedule[i]->getId()] = i;
+    newContext->moduleContexts.push_back(makeModuleContext(*schedule[i]));
+  }
+
+  std::vector<AudioAlias> aliases(schedule.size());
+  for (size_t i = 0; i < schedule.size(); ++i)
+  {
+    aliases[i] = findAudioAlias(*schedule[i], i, getInputConnections(schedule[i]->getId()), stepsById,
+                                *newContext);
+  }
+  std::vector<bool*> silenceFlags;
+  std::vector<bool> sharesMemory;
+  allocateAudioBuffers(*newContext, aliases, stepsById, silenceFlags, sharesMemory);
+  allocateEventBuffers(*newContext);
+  newContext->numSilentSamples.resize(schedule.size(), 0);
+
+  // compile the modules, in an order where every module comes after its inputs
+  std::vector<std::vector<size_t>> upstreams(schedule.size());
+  newContext->modules.reserve(schedule.size());
+  for (size_t i = 0; i < schedule.size(); ++i)
+  {
+    compileModule(*schedule[i], i, aliases[i].isAlias, sharesMemory[i], getInputConnections(schedule[i]->getId()),
+                  stepsById, silenceFlags, *newContext, upstreams[i]);
+  }
+
+  // set up the dependencies for parallel processing
+  if (nullptr != _workerPool)
+  {
+    const size_t numModules = newContext->modules.size();
+
+    for (size_t i = 0; i < numModules; ++i)
+    {
+      auto& m = newContext->modules[i];
+      for (auto upstreamIdx : upstreams[i])
       {
-        break;
+        auto& upstream = newContext->modules[upstreamIdx];
+        // only count each upstream module once, no matter how many connections it has to this one
+        if (upstream.dependents.empty() || upstream.dependents.back() != i)
+        {
+          upstream.dependents.push_back(i);
+          ++m.numDependencies;
+        }
       }
     }
-    auto renderInfo = makeModuleRenderInfo(*m);
-    newContext->modules.insert(newContext->modules.begin() + insertIdx, renderInfo);
+
+    newContext->workerPool = _workerPool;
+    newContext->numPendingInputs.reset(new std::atomic<size_t>[numModules]);
+    for (size_t i = 0; i < _workerPool->getNumWorkers() + 1; ++i)
+    {
+      newContext->queues.emplace_back(std::make_unique<WorkStealingQueue>(numModules));
+    }
   }
-  newContext->modules.push_back(makeModuleRenderInfo(_outputModule));
 
-  // swap in the new context
-  newContext = std::atomic_exchange(&_graphProcessContext, newContext);
-  // spin here in case process() is still using the old context
-  while (newContext.use_count() > 1)
-  {}
+  // swap in the new context, and let the old one go once process() is done with it
+  _graphProcessContext.store(newContext.get());
+  std::swap(_graphProcessContextOwner, newContext);
+  _reclaimer.retire(std::move(newContext));
 
-  // now that the old context is gone, we can clear the released modules
+  // the released modules can't be reached from the new context, so they can go too
+  for (auto& m : _modulesToRelease)
+  {
+    _reclaimer.retire(std::move(m));
+  }
   _modulesToRelease.clear();
+
+  // same goes for any params the modules have released
+  retireReleasedParams(_inputModule);
+  retireReleasedParams(_outputModule);
+  for (auto& m : _modules)
+  {
+    retireReleasedParams(*m);
+  }
+}
+
+void dc::Graph::retireReleasedParams(Module& m)
+{
+  for (auto& p : m._paramsToRelease)
+  {
+    _reclaimer.retire(std::move(p));
+  }
+  m._paramsToRelease.clear();
+}
+
+std::unique_ptr<dc::Module::ModuleProcessContext> dc::Graph::makeModuleContext(const Module& m)
+{
+  auto* layout = m._processContext.get();
+  if (nullptr == layout)
+  {
+    return nullptr;
+  }
+
+  auto context = std::make_unique<ModuleProcessContext>();
+  context->numAudioIn = layout->numAudioIn;
+  context->numAudioOut = layout->numAudioOut;
+  context->numEventIn = layout->numEventIn;
+  context->numEventOut = layout->numEventOut;
+  context->blockSize = layout->blockSize;
+  context->sampleRate = layout->sampleRate;
+  context->tailLength = layout->tailLength;
+  // their memory comes from the event pool
+  context->eventBuffer.setNumChannels(std::max(layout->numEventIn, layout->numEventOut), 0);
+  context->params = layout->params;
+  context->paramBuffer.resize(layout->blockSize, layout->params.size());
+  return context;
+}
+
+dc::Graph::AudioAlias dc::Graph::findAudioAlias(const Module& m, size_t step,
+                                                const std::vector<Connection>& inputConnections,
+                                                const std::unordered_map<size_t, size_t>& stepsById,
+                                                const GraphProcessContext& context)
+{
+  // the module can only use the upstream buffer as its own if it never writes to it,
+  // and every one of its channels comes from the same module, one to one, in order
+  AudioAlias alias;
+  auto* ctx = context.moduleContexts[step].get();
+  if (nullptr == ctx || ctx->numAudioIn == 0 || !m.isAudioReadOnly())
+  {
+    return alias;
+  }
+
+  const size_t numChannels = std::max(ctx->numAudioIn, ctx->numAudioOut);
+  std::vector<bool> haveChannel(numChannels, false);
+  size_t numAudioConnections = 0;
+
+  for (auto& c : inputConnections)
+  {
+    if (c.type != Connection::Type::Audio)
+    {
+      continue;
+    }
+
+    auto upstream = stepsById.find(c.fromId);
+    if (upstream == stepsById.end() || c.toIdx >= numChannels || c.fromIdx < c.toIdx || haveChannel[c.toIdx])
+    {
+      return {};
+    }
+
+    const size_t channel = c.fromIdx - c.toIdx;
+    if (numAudioConnections == 0)
+    {
+      alias.step = upstream->second;
+      alias.channel = channel;
+    }
+    else if (upstream->second != alias.step || channel != alias.channel)
+    {
+      return {};
+    }
+
+    haveChannel[c.toIdx] = true;
+    ++numAudioConnections;
+  }
+
+  if (numAudioConnections != numChannels)
+  {
+    return {};
+  }
+
+  auto* upstreamCtx = context.moduleContexts[alias.step].get();
+  if (nullptr == upstreamCtx || upstreamCtx->blockSize != ctx->blockSize
+      || alias.channel + numChannels > std::max(upstreamCtx->numAudioIn, upstreamCtx->numAudioOut))
+  {
+    return {};
+  }
+
+  alias.isAlias = true;
+  return alias;
+}
+
+void dc::Graph::allocateAudioBuffers(GraphProcessContext& context, const std::vector<AudioAlias>& aliases,
+                                     const std::unordered_map<size_t, size_t>& stepsById,
+                                     std::vector<bool*>& silenceFlagsOut, std::vector<bool>& sharesMemoryOut)
+{
+  auto& contexts = context.moduleContexts;
+
+  // a module's buffer is needed from its own step until the last module that reads from it is done
+  std::vector<size_t> lastSteps(contexts.size());
+  for (size_t i = 0; i < lastSteps.size(); ++i)
+  {
+    lastSteps[i] = i;
+  }
+  for (auto& c : _allConnections)
+  {
+    if (c.type == Connection::Type::Audio)
+    {
+      // connections into modules that aren't processed don't keep anything alive
+      auto from = stepsById.find(c.fromId);
+      auto to = stepsById.find(c.toId);
+      if (from != stepsById.end() && to != stepsById.end())
+      {
+        lastSteps[from->second] = std::max(lastSteps[from->second], to->second);
+      }
+    }
+  }
+
+  // anything reading an alias is really reading the buffer behind it,
+  // and aliases always come after what they point to, so work backwards to pass that along
+  for (size_t i = contexts.size(); i-- > 0;)
+  {
+    if (aliases[i].isAlias)
+    {
+      const size_t target = aliases[i].step;
+      lastSteps[target] = std::max(lastSteps[target], lastSteps[i]);
+    }
+  }
+
+  BufferPlanner planner;
+  size_t numFlags = 0;
+  for (size_t i = 0; i < contexts.size(); ++i)
+  {
+    if (nullptr != contexts[i] && !aliases[i].isAlias)
+    {
+      const size_t numChannels = std::max(contexts[i]->numAudioIn, contexts[i]->numAudioOut);
+      planner.addBuffer(AudioBuffer::getPaddedStride(contexts[i]->blockSize) * numChannels, i, lastSteps[i]);
+      numFlags += numChannels;
+    }
+    else
+    {
+      planner.addBuffer(0, i, lastSteps[i]);
+    }
+  }
+
+  // With worker threads, modules can run in any order, so their buffers just go end to end.
+  // Either way, the silence flags get one each, all together so the program can get at them quickly.
+  std::vector<size_t> offsets(contexts.size(), 0);
+  size_t poolSize = 0;
+  if (nullptr != _workerPool)
+  {
+    for (size_t i = 0; i < contexts.size(); ++i)
+    {
+      offsets[i] = poolSize;
+      poolSize += planner.getSize(i);
+    }
+  }
+  else
+  {
+    poolSize = planner.plan();
+    for (size_t i = 0; i < contexts.size(); ++i)
+    {
+      offsets[i] = planner.getOffset(i);
+    }
+  }
+  context.silenceFlags.reset(new bool[numFlags]);
+  _pooledAudioMemory = poolSize * sizeof(float);
+
+  // every buffer is a whole number of cache lines, so lining up the start of the pool lines up all of them
+  const size_t samplesPerLine = AudioBuffer::ALIGNMENT / sizeof(float);
+  context.audioPool.resize(poolSize + samplesPerLine);
+  float* pool = context.audioPool.data();
+  const size_t misalignment = reinterpret_cast<uintptr_t>(pool) % AudioBuffer::ALIGNMENT;
+  if (misalignment != 0)
+  {
+    pool += (AudioBuffer::ALIGNMENT - misalignment) / sizeof(float);
+  }
+
+  // aliases come after the buffers they point to, so everything's in place by the time we get to them
+  size_t numAliasedSamples = 0;
+  size_t nextFlag = 0;
+  silenceFlagsOut.assign(contexts.size(), nullptr);
+  for (size_t i = 0; i < contexts.size(); ++i)
+  {
+    auto* ctx = contexts[i].get();
+    if (nullptr == ctx)
+    {
+      continue;
+    }
+
+    const size_t numChannels = std::max(ctx->numAudioIn, ctx->numAudioOut);
+    if (aliases[i].isAlias)
+    {
+      auto& upstream = contexts[aliases[i].step]->audioBuffer;
+      silenceFlagsOut[i] = silenceFlagsOut[aliases[i].step] + aliases[i].channel;
+      ctx->audioBuffer.setExternalData(upstream.getChannelPointer(aliases[i].channel), silenceFlagsOut[i],
+                                       upstream.getNumSamples(), numChannels, upstream.getChannelStride());
+      numAliasedSamples += AudioBuffer::getPaddedStride(ctx->blockSize) * numChannels;
+    }
+    else
+    {
+      silenceFlagsOut[i] = context.silenceFlags.get() + nextFlag;
+      nextFlag += numChannels;
+      for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+      {
+        silenceFlagsOut[i][cIdx] = false;
+      }
+      ctx->audioBuffer.setExternalData(pool + offsets[i], silenceFlagsOut[i], ctx->blockSize, numChannels,
+                                       AudioBuffer::getPaddedStride(ctx->blockSize));
+    }
+  }
+
+  // A buffer whose memory another buffer uses too can be written over between one of its module's turns and the next,
+  // so its flags have to be forgotten at the start of each turn. Sorted by where they start, a buffer overlaps another
+  // if it starts before one of the earlier ones ends, or the next one starts before it ends.
+  sharesMemoryOut.assign(contexts.size(), false);
+  if (nullptr == _workerPool)
+  {
+    std::vector<size_t> byOffset;
+    for (size_t i = 0; i < contexts.size(); ++i)
+    {
+      if (nullptr != contexts[i] && !aliases[i].isAlias && planner.getSize(i) > 0)
+      {
+        byOffset.push_back(i);
+      }
+    }
+    std::sort(byOffset.begin(), byOffset.end(), [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+    size_t maxEnd = 0;
+    for (size_t k = 0; k < byOffset.size(); ++k)
+    {
+      const size_t i = byOffset[k];
+      const size_t end = offsets[i] + planner.getSize(i);
+      sharesMemoryOut[i] = (k > 0 && offsets[i] < maxEnd)
+                           || (k + 1 < byOffset.size() && offsets[byOffset[k + 1]] < end);
+      maxEnd = std::max(maxEnd, end);
+    }
+
+    // the graph's input is filled in by process(), before the program runs
+    sharesMemoryOut[0] = false;
+  }
+
+  _unpooledAudioMemory = (planner.getUnpooledSize() + numAliasedSamples) * sizeof(float);
 }
 
-dc::Graph::ModuleRenderInfo dc::Graph::makeModuleRenderInfo(Module& m)
+void dc::Graph::allocateEventBuffers(GraphProcessContext& context)
 {
+  // every event channel gets the same share of one pool
+  size_t numChannels = 0;
+  for (auto& ctx : context.moduleContexts)
+  {
+    if (nullptr != ctx)
+    {
+      numChannels += ctx->eventBuffer.getNumChannels();
+    }
+  }
+
+  const size_t poolSize = numChannels * _eventChannelCapacity;
+  context.eventPool.reset(poolSize > 0 ? new EventMessage[poolSize] : nullptr);
+  _eventPoolMemory = poolSize * sizeof(EventMessage);
+
+  // keep counting from where the last context left off
+  if (nullptr != _graphProcessContextOwner)
+  {
+    context.numEventOverflows = _graphProcessContextOwner->numEventOverflows.load();
+  }
+
+  auto* pool = context.eventPool.get();
+  for (auto& ctx : context.moduleContexts)
+  {
+    if (nullptr == ctx)
+    {
+      continue;
+    }
+    for (size_t cIdx = 0; cIdx < ctx->eventBuffer.getNumChannels(); ++cIdx)
+    {
+      ctx->eventBuffer.getChannel(cIdx)->setExternalStorage(pool, _eventChannelCapacity, &context.numEventOverflows);
+      pool += _eventChannelCapacity;
+    }
+  }
+}
+
+void dc::Graph::compileModule(Module& m, size_t step, bool isAudioAlias, bool sharesMemory,
+                              const std::vector<Connection>& inputConnections,
+                              const std::unordered_map<size_t, size_t>& stepsById,
+                              const std::vector<bool*>& silenceFlags,
+                              GraphProcessContext& context, std::vector<size_t>& upstreamsOut)
+{
+  auto& program = context.program;
+
   ModuleRenderInfo info;
-  info.module = &m;
+  info.context = context.moduleContexts[step].get();
+  info.firstOp = program.size();
 
-  std::vector<Connection> connections;
-  if (getInputConnectionsForModule(m, connections))
+  if (auto* ctx = info.context)
   {
-    for (auto& c : connections)
+    if (sharesMemory)
+    {
+      RenderOp op{};
+      op.type = RenderOp::Type::ForgetSilence;
+      op.silence = {silenceFlags[step], ctx->audioBuffer.getNumChannels()};
+      program.push_back(op);
+    }
+
+    // if this module has inputs, pull in the input data
+    if (ctx->numAudioIn > 0 || ctx->numEventIn > 0)
     {
-      if (auto* upstream = getModuleById(c.fromId))
+      RenderOp op{};
+
+      for (size_t cIdx = 0; cIdx < ctx->eventBuffer.getNumChannels(); ++cIdx)
+      {
+        op.type = RenderOp::Type::ClearEvents;
+        op.events = {nullptr, ctx->eventBuffer.getChannel(cIdx), EventMessage::None};
+        program.push_back(op);
+      }
+
+      auto& audio = ctx->audioBuffer;
+      const size_t numSamples = audio.getNumSamples();
+      std::vector<std::vector<RenderOp::AudioArgs>> audioSources(isAudioAlias ? 0 : audio.getNumChannels());
+
+      for (auto& c : inputConnections)
       {
-        EventMessage::Type emType = EventMessage::None;
-        if (c.type == Connection::Type::Event)
+        auto upstream = stepsById.find(c.fromId);
+        if (upstream == stepsById.end() || nullptr == context.moduleContexts[upstream->second])
+        {
+          continue;
+        }
+
+        auto* inCtx = context.moduleContexts[upstream->second].get();
+        upstreamsOut.push_back(upstream->second);
+
+        switch (c.type)
         {
-          if (auto* io = m.getIo(Event | Input, c.toIdx))
+          case Connection::Type::Audio:
           {
-            emType = io->eventTypeFlags;
+            if (c.fromIdx < inCtx->audioBuffer.getNumChannels() && c.toIdx < audioSources.size())
+            {
+              audioSources[c.toIdx].push_back({inCtx->audioBuffer.getChannelPointer(c.fromIdx),
+                                               audio.getChannelPointer(c.toIdx),
+                                               silenceFlags[upstream->second] + c.fromIdx,
+                                               silenceFlags[step] + c.toIdx,
+                                               std::min(numSamples, inCtx->audioBuffer.getNumSamples())});
+            }
+            break;
           }
+          case Connection::Type::Event:
+          {
+            auto* from = inCtx->eventBuffer.getChannel(c.fromIdx);
+            auto* to = ctx->eventBuffer.getChannel(c.toIdx);
+            if (nullptr != from && nullptr != to)
+            {
+              EventMessage::Type emType = EventMessage::None;
+              if (auto* io = m.getIo(Event | Input, c.toIdx))
+              {
+                emType = io->eventTypeFlags;
+              }
+              op.type = RenderOp::Type::RouteEvents;
+              op.events = {from, to, emType};
+              program.push_back(op);
+            }
+            break;
+          }
+          default:;
+        }
+      }
+
+      // A channel with a single source that fills it is just copied.
+      // Anything else is cleared, and then summed into.
+      for (size_t cIdx = 0; cIdx < audioSources.size(); ++cIdx)
+      {
+        auto& sources = audioSources[cIdx];
+        if (sources.size() == 1 && sources[0].numSamples == numSamples)
+        {
+          op.type = RenderOp::Type::CopyChannel;
+          op.audio = sources[0];
+          program.push_back(op);
+          continue;
         }
 
-        info.inputs.push_back({upstream, c.type, c.fromIdx, c.toIdx, emType});
+        op.type = RenderOp::Type::Zero;
+        op.audio = {nullptr, audio.getChannelPointer(cIdx), nullptr, silenceFlags[step] + cIdx, numSamples};
+        program.push_back(op);
+
+        op.type = RenderOp::Type::AddChannel;
+        for (auto& source : sources)
+        {
+          op.audio = source;
+          program.push_back(op);
+        }
       }
     }
+
+    // the module can only sleep if the graph fills in its buffer, so there's something silent to leave there
+    size_t* numSilentSamples = nullptr;
+    if (ctx->tailLength != MODULE_INFINITE_TAIL && (ctx->numAudioIn > 0 || ctx->numEventIn > 0))
+    {
+      numSilentSamples = &context.numSilentSamples[step];
+    }
+
+    RenderOp op{};
+    op.type = RenderOp::Type::Process;
+    op.process = {&m, ctx, numSilentSamples};
+    program.push_back(op);
   }
 
-  return info;
+  info.endOp = program.size();
+  context.modules.push_back(std::move(info));
 }
 
 void dc::Graph::clear()
 {
+  ScopedEdit edit(*this);
+  // from the back, so nothing has to shift down
   while (!_modules.empty())
   {
-    removeModuleAt(0);
+    removeModuleAt(_modules.size() - 1);
   }
-  _nextModuleId = 3;
+  // ids keep counting up, so param changes still on their way to the old modules can't land on new ones
 }
 
 size_t dc::Graph::addModule(std::unique_ptr<Module> module, size_t graphId)
@@ -223,10 +911,20 @@ size_t dc::Graph::addModule(std::unique_ptr<Module> module, size_t graphId)
   }
 
   module->_id = id;
+  module->_graph = this;
 
-  module->setBlockSize(_blockSize);
-  module->setSampleRate(_sampleRate);
+  {
+    ScopedEdit edit(*module);
+    module->setBlockSize(_blockSize);
+    module->setSampleRate(_sampleRate);
+  }
 
+  _topology.addNode(id);
+  if (module->hasSideEffects())
+  {
+    _topology.addSink(id);
+  }
+  _moduleIndices[id] = _modules.size();
   _modules.push_back(std::move(module));
 
   updateGraphProcessContext();
@@ -255,12 +953,10 @@ dc::Module* dc::Graph::getModuleById(size_t id)
     return &_outputModule;
   }
 
-  for (auto& m : _modules)
+  auto it = _moduleIndices.find(id);
+  if (it != _moduleIndices.end())
   {
-    if (m->getId() == id)
-    {
-      return m.get();
-    }
+    return _modules[it->second].get();
   }
   return nullptr;
 }
@@ -272,12 +968,10 @@ bool dc::Graph::removeModuleAt(size_t index)
 
 bool dc::Graph::removeModuleById(size_t id)
 {
-  for (size_t i = 0; i < _modules.size(); ++i)
+  auto it = _moduleIndices.find(id);
+  if (it != _moduleIndices.end())
   {
-    if (_modules[i]->getId() == id)
-    {
-      return removeModuleAt(i);
-    }
+    return removeModuleAt(it->second);
   }
   return false;
 }
@@ -289,7 +983,11 @@ bool dc::Graph::addConnection(const Connection& connection)
     return false;
   }
 
+  _connectionIndices[connection] = _allConnections.size();
   _allConnections.push_back(connection);
+  _moduleConnections[connection.fromId].outputs.push_back(connection);
+  _moduleConnections[connection.toId].inputs.push_back(connection);
+  addTopologyEdge(connection);
 
   updateGraphProcessContext();
 
@@ -303,48 +1001,58 @@ void dc::Graph::removeConnection(const Connection& connection)
     return;
   }
 
-  for (size_t i = 0; i < _allConnections.size(); ++i)
+  removeConnectionInternal(connection);
+  updateGraphProcessContext();
+}
+
+void dc::Graph::removeConnectionInternal(const Connection& connection)
+{
+  // the last connection takes its place
+  auto it = _connectionIndices.find(connection);
+  const size_t index = it->second;
+  _connectionIndices.erase(it);
+  if (index + 1 < _allConnections.size())
   {
-    // handle zeroing the control input if there is one
-    if (_allConnections[i] == connection)
-    {
-      _allConnections.erase(_allConnections.begin() + i);
+    _allConnections[index] = _allConnections.back();
+    _connectionIndices[_allConnections[index]] = index;
+  }
+  _allConnections.pop_back();
 
-      if (connection.type == Connection::Type::Event)
+  // the modules' own lists stay in order, so their inputs are summed in the same order as before
+  auto removeFrom = [&connection](std::vector<Connection>& connections)
+  {
+    connections.erase(std::find(connections.begin(), connections.end(), connection));
+  };
+  removeFrom(_moduleConnections[connection.fromId].outputs);
+  removeFrom(_moduleConnections[connection.toId].inputs);
+  removeTopologyEdge(connection);
+
+  // handle zeroing the control input if there is one
+  if (connection.type == Connection::Type::Event)
+  {
+    if (auto* m = getModuleById(connection.toId))
+    {
+      bool hasOtherConnection = false;
+      for (auto& c : getInputConnections(connection.toId))
       {
-        if (auto* m = getModuleById(connection.toId))
+        if (c.type == Connection::Type::Event && c.toIdx == connection.toIdx)
         {
-          bool hasOtherConnection = false;
-          std::vector<Connection> cs;
-          if (getInputConnectionsForModule(*m, cs))
-          {
-            for (auto& c : cs)
-            {
-              if (c.toIdx == connection.toIdx)
-              {
-                hasOtherConnection = true;
-                break;
-              }
-            }
-          }
+          hasOtherConnection = true;
+          break;
+        }
+      }
 
-          if (!hasOtherConnection)
+      if (!hasOtherConnection)
+      {
+        for (auto& p : m->_params)
+        {
+          if (p->getControlInputIndex() == static_cast<int>(connection.toIdx))
           {
-            for (auto& p : m->_params)
-            {
-              if (p->getControlInputIndex() == static_cast<int>(connection.toIdx))
-              {
-                p->setControlInput(0.0f);
-                break;
-              }
-            }
+            p->setControlInput(0.0f);
+            break;
           }
         }
       }
-
-      updateGraphProcessContext();
-
-      break;
     }
   }
 }
@@ -361,26 +1069,74 @@ bool dc::Graph::getConnection(size_t index, Connection& connectionOut)
 
 void dc::Graph::disconnectModule(size_t id)
 {
-  if (auto* m = getModuleById(id))
+  // however many connections go, the context is only rebuilt once
+  if (disconnectModuleInternal(id))
   {
-    size_t i = 0;
-    while (i < _allConnections.size())
+    updateGraphProcessContext();
+  }
+}
+
+bool dc::Graph::disconnectModuleInternal(size_t id)
+{
+  auto it = _moduleConnections.find(id);
+  if (it == _moduleConnections.end())
+  {
+    return false;
+  }
+
+  // copies, since removing the connections changes the lists
+  const auto inputs = it->second.inputs;
+  const auto outputs = it->second.outputs;
+  for (auto& c : inputs)
+  {
+    removeConnectionInternal(c);
+  }
+  for (auto& c : outputs)
+  {
+    // in case it was connected to itself, and went with the inputs
+    if (connectionExists(c))
     {
-      auto& c = _allConnections[i];
-      if (c.fromId == id || c.toId == id)
-      {
-        removeConnection(c);
-      }
-      else
-      {
-        ++i;
-      }
+      removeConnectionInternal(c);
     }
   }
+  _moduleConnections.erase(id);
+
+  return !inputs.empty() || !outputs.empty();
+}
+
+void dc::Graph::setNumWorkerThreads(size_t numThreads, const WorkerPool::ThreadSetupFn& setupThread)
+{
+  if (numThreads == _numWorkerThreads && !setupThread)
+  {
+    return;
+  }
+
+  _numWorkerThreads = numThreads;
+  _workerPool = numThreads > 0 ? std::make_shared<WorkerPool>(numThreads, setupThread) : nullptr;
+
+  // the old pool is shut down once the audio thread is done with the old context
+  updateGraphProcessContext();
+}
+
+void dc::Graph::setEventChannelCapacity(size_t numMessages)
+{
+  if (numMessages == _eventChannelCapacity)
+  {
+    return;
+  }
+
+  _eventChannelCapacity = numMessages;
+  updateGraphProcessContext();
+}
+
+size_t dc::Graph::getNumEventOverflows() const
+{
+  return nullptr != _graphProcessContextOwner ? _graphProcessContextOwner->numEventOverflows.load() : 0;
 }
 
 void dc::Graph::blockSizeChanged()
 {
+  ScopedEdit edit(*this);
   _inputModule.setBlockSize(_blockSize);
   _outputModule.setBlockSize(_blockSize);
   for (auto& m : _modules)
@@ -389,6 +1145,24 @@ void dc::Graph::blockSizeChanged()
   }
 }
 
+void dc::Graph::editCommitted()
+{
+  // apply any changes the modules were holding on to for us, then rebuild once
+  _applyingDeferredEdits = true;
+  _inputModule.applyDeferredEdits();
+  _outputModule.applyDeferredEdits();
+  for (auto& m : _modules)
+  {
+    m->applyDeferredEdits();
+  }
+  _applyingDeferredEdits = false;
+
+  if (_graphProcessContextDirty)
+  {
+    updateGraphProcessContext();
+  }
+}
+
 bool dc::Graph::addIoInternal(std::vector<Io>& io, const std::string& description, EventMessage::Type controlType)
 {
   if (!Module::addIoInternal(io, description, controlType))
@@ -487,14 +1261,7 @@ bool dc::Graph::connectionIsValid(const Connection& connection)
 
 bool dc::Graph::connectionExists(const Connection& connection)
 {
-  for (auto& c : _allConnections)
-  {
-    if (c == connection)
-    {
-      return true;
-    }
-  }
-  return false;
+  return _connectionIndices.count(connection) > 0;
 }
 
 bool dc::Graph::getModulesForConnection(const Connection& connection, Module*& from, Module*& to)
@@ -506,57 +1273,51 @@ bool dc::Graph::getModulesForConnection(const Connection& connection, Module*& f
 
 bool dc::Graph::connectionCreatesLoop(const Connection& connection)
 {
-  Module* from = nullptr;
-  Module* to = nullptr;
+  // the graph's own I/O modules aren't part of the topology,
+  // but nothing can feed the input module or be fed by the output module anyway
+  return _topology.edgeCreatesCycle(connection.fromId, connection.toId);
+}
 
-  if (!getModulesForConnection(connection, from, to))
+size_t dc::Graph::ConnectionHash::operator()(const Connection& c) const
+{
+  size_t hash = std::hash<size_t>()(c.fromId);
+  for (size_t value : {c.fromIdx, c.toId, c.toIdx, static_cast<size_t>(c.type)})
   {
-    return false;
+    hash ^= std::hash<size_t>()(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
   }
-
-  return moduleIsInputTo(to, from);
+  return hash;
 }
 
-bool dc::Graph::moduleIsInputTo(Module* from, Module* to)
+const std::vector<dc::Connection>& dc::Graph::getInputConnections(size_t id) const
 {
-  if (from == to)
-  {
-    return true;
-  }
+  static const std::vector<Connection> none;
+  auto it = _moduleConnections.find(id);
+  return it != _moduleConnections.end() ? it->second.inputs : none;
+}
 
-  if (nullptr == from || nullptr == to)
+void dc::Graph::addTopologyEdge(const Connection& connection)
+{
+  // the graph's I/O modules aren't in the topology, and the output is where everything ends up
+  if (connection.toId == _outputModule.getId())
   {
-    return false;
+    _topology.addSink(connection.fromId);
   }
-
-  std::vector<Connection> connections;
-  if (getInputConnectionsForModule(*to, connections))
+  else
   {
-    for (auto& c : connections)
-    {
-      if (auto* m = getModuleById(c.fromId))
-      {
-        if (moduleIsInputTo(from, m))
-        {
-          return true;
-        }
-      }
-    }
+    _topology.addEdge(connection.fromId, connection.toId);
   }
-
-  return false;
 }
 
-bool dc::Graph::getInputConnectionsForModule(Module& m, std::vector<Connection>& connections)
+void dc::Graph::removeTopologyEdge(const Connection& connection)
 {
-  for (auto& c : _allConnections)
+  if (connection.toId == _outputModule.getId())
   {
-    if (c.toId == m.getId())
-    {
-      connections.push_back(c);
-    }
+    _topology.removeSink(connection.fromId);
+  }
+  else
+  {
+    _topology.removeEdge(connection.fromId, connection.toId);
   }
-  return !connections.empty();
 }
 
 bool dc::Graph::removeModuleInternal(size_t index)
@@ -566,13 +1327,22 @@ bool dc::Graph::removeModuleInternal(size_t index)
     return false;
   }
 
-  // disconnect the module
-  disconnectModule(_modules[index]->_id);
+  // disconnect the module, and rebuild the context once for all of it
+  disconnectModuleInternal(_modules[index]->_id);
 
   // stick the module into the release pool
+  _topology.removeNode(_modules[index]->_id);
+  _moduleIndices.erase(_modules[index]->_id);
+  _modules[index]->_graph = nullptr;
   _modulesToRelease.emplace_back(_modules[index].release());
   _modules.erase(_modules.begin() + index);
 
+  // everything after it moved down one
+  for (size_t i = index; i < _modules.size(); ++i)
+  {
+    _moduleIndices[_modules[i]->_id] = i;
+  }
+
   // update the process context
   updateGraphProcessContext();
 
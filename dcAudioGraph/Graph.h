@@ -7,7 +7,12 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
+#include "GraphTopology.h"
 #include "Module.h"
+#include "MultiProducerMessageQueue.h"
+#include "Reclaimer.h"
+#include "WorkerPool.h"
 
 namespace dc
 {
@@ -33,14 +38,20 @@ struct Connection final
 class Graph final : public Module
 {
 public:
+  friend class Module;
+
   Graph();
 
+  // Processes a block. The graph's input comes out of audio and events, and its output goes back into them.
+  // Size them up front, events included, see EventBuffer::setNumChannels(), so this doesn't allocate.
   void process(AudioBuffer& audio, EventBuffer& events) const;
 
   Module* getInputModule() { return &_inputModule; }
 
   Module* getOutputModule() { return &_outputModule; }
 
+  // Removes every module but the input and output.
+  // New modules don't get the ids of the old ones, unless they're asked for.
   void clear();
 
   size_t addModule(std::unique_ptr<Module> module, size_t graphId = 0);
@@ -69,18 +80,78 @@ public:
 
   void disconnectModule(size_t id);
 
+  // Set the number of extra threads used to process the modules in this graph.
+  // The default of 0 processes everything on the thread calling process().
+  // Otherwise, modules are handed to the workers as soon as all of their inputs are ready.
+  // The output is the same either way.
+  // setupThread is called on each new worker thread before it starts, to raise its priority to match the audio thread,
+  // pin it to a core and so on. Setting it replaces the workers, even if there are as many as before.
+  void setNumWorkerThreads(size_t numThreads, const WorkerPool::ThreadSetupFn& setupThread = nullptr);
+
+  size_t getNumWorkerThreads() const { return _numWorkerThreads; }
+
+  // How much memory the modules' audio buffers use, in bytes.
+  // On a single thread, modules whose buffers are never needed at the same time share memory,
+  // so this grows with how wide the graph is rather than how many modules it has.
+  // With worker threads, every module gets a buffer of its own.
+  // Either way, modules with read-only audio can read straight out of the buffer that feeds them.
+  size_t getPooledAudioMemory() const { return _pooledAudioMemory; }
+
+  // how much memory the modules' audio buffers would use with a buffer each, in bytes
+  size_t getUnpooledAudioMemory() const { return _unpooledAudioMemory; }
+
+  // How many event messages each of the modules' event channels has room for.
+  // The channels share one block of memory, so they don't have to allocate on the audio thread.
+  // A channel that gets more messages than this in a block keeps the earliest and drops the rest,
+  // counting each one dropped as an overflow.
+  void setEventChannelCapacity(size_t numMessages);
+
+  size_t getEventChannelCapacity() const { return _eventChannelCapacity; }
+
+  // how much memory the modules' event channels share, in bytes
+  size_t getEventPoolMemory() const { return _eventPoolMemory; }
+
+  // how many event messages have been dropped because a channel's share of the pool was full
+  size_t getNumEventOverflows() const;
+
+  static const size_t DEFAULT_EVENT_CHANNEL_CAPACITY = 64;
+
+  // The graph's sample clock: the time of the first sample of the next block process() is called for.
+  // It starts at 0, and goes up by the block size with every call to process().
+  uint64_t getSampleTime() const { return _sampleTime.load(std::memory_order_acquire); }
+
+  // Sets a module's param to rawValue at a sample time on the graph's clock, from any thread, without waiting.
+  // The change lands on that exact sample: the param holds where it was until then, and steps to it there.
+  // A time that's already gone by lands at the start of the next block.
+  // Changes for modules or params that don't exist by the time they land are dropped.
+  // Returns false if there are PARAM_CHANGE_QUEUE_SIZE changes waiting already.
+  bool postParamChange(size_t moduleId, size_t paramIndex, float rawValue, uint64_t sampleTime);
+
+  static const size_t PARAM_CHANGE_QUEUE_SIZE = 1024;
+
+  // Edits never wait for the audio thread. Anything they replace is freed by a later edit,
+  // once process() is done with it. Call this from time to time if you want it freed sooner.
+  void collectRetired() { _reclaimer.collect(); }
+
 protected:
   void process(ModuleProcessContext& context) override;
 
+  // there's no telling what the modules inside are up to
+  bool hasSideEffects() const override { return true; }
+
 private:
   // Just a passthrough for processing graph I/O
   // This also provides a way to connect modules in the graph to the outside world
   class GraphIoModule final : public Module
   {
+  protected:
+    bool isAudioReadOnly() const override { return true; }
   };
 
   void blockSizeChanged() override;
 
+  void editCommitted() override;
+
   bool addIoInternal(std::vector<Io>& io, const std::string& description, EventMessage::Type controlType) override;
 
   bool removeIoInternal(std::vector<Io>& io, size_t index) override;
@@ -89,44 +160,204 @@ private:
 
   bool connectionCreatesLoop(const Connection& connection);
 
-  bool moduleIsInputTo(Module* from, Module* to);
+  struct ConnectionHash final
+  {
+    size_t operator()(const Connection& c) const;
+  };
+
+  // a module's connections, in the order they were made
+  struct ModuleConnections final
+  {
+    std::vector<Connection> inputs;
+    std::vector<Connection> outputs;
+  };
+
+  const std::vector<Connection>& getInputConnections(size_t id) const;
 
-  bool getInputConnectionsForModule(Module& m, std::vector<Connection>& connections);
+  // these leave updating the process context to the caller, so a batch of changes only does it once
+  void removeConnectionInternal(const Connection& connection);
+
+  bool disconnectModuleInternal(size_t id);
 
   bool removeModuleInternal(size_t index);
 
-  struct ModuleRenderInfo final
+  // connections to the graph's output mark their source as a sink, everything else is an edge
+  void addTopologyEdge(const Connection& connection);
+
+  void removeTopologyEdge(const Connection& connection);
+
+  // A single step of processing the graph.
+  // The whole graph compiles down to one flat list of these, with everything resolved ahead of time.
+  struct RenderOp final
   {
-    struct InputInfo
+    enum class Type : uint8_t
+    {
+      ForgetSilence,
+      Zero,
+      CopyChannel,
+      AddChannel,
+      ClearEvents,
+      RouteEvents,
+      Process
+    };
+
+    struct AudioArgs
+    {
+      const float* from;
+      float* to;
+      const bool* fromSilent;
+      bool* toSilent;
+      size_t numSamples;
+    };
+
+    // for a buffer in memory that other modules' buffers use too, so its flags can't be trusted from block to block
+    struct SilenceArgs
+    {
+      bool* flags;
+      size_t numChannels;
+    };
+
+    struct EventArgs
+    {
+      EventBuffer::Channel* from;
+      EventBuffer::Channel* to;
+      EventMessage::Type typeFlags;
+    };
+
+    struct ProcessArgs
     {
       Module* module;
-      Connection::Type type;
-      size_t fromIdx;
-      size_t toIdx;
-      EventMessage::Type eventTypeFlags;
+      ModuleProcessContext* context;
+      // how long the module's input has been silent for, or nullptr if it never sleeps
+      size_t* numSilentSamples;
+    };
+
+    Type type;
+
+    union
+    {
+      AudioArgs audio;
+      SilenceArgs silence;
+      EventArgs events;
+      ProcessArgs process;
     };
+  };
 
-    Module* module = nullptr;
-    std::vector<InputInfo> inputs;
+  // a module that reads its audio straight out of an upstream module's buffer, from channel onwards
+  struct AudioAlias final
+  {
+    bool isAlias = false;
+    size_t step = 0;
+    size_t channel = 0;
   };
 
+  // where a module's ops are in the program
+  struct ModuleRenderInfo final
+  {
+    ModuleProcessContext* context = nullptr;
+    size_t firstOp = 0;
+    size_t endOp = 0;
+
+    // for parallel processing, indices of the modules that take input from this one
+    std::vector<size_t> dependents;
+    size_t numDependencies = 0;
+  };
+
+  struct ParamChange final
+  {
+    size_t moduleId;
+    size_t paramIndex;
+    float rawValue;
+    uint64_t sampleTime;
+  };
+
+  // a module's params, for applying param changes
+  struct ParamTarget final
+  {
+    size_t moduleId;
+    std::vector<ModuleParam*> params;
+    // false if the module isn't in the program, so its changes land straight away
+    bool isProcessed;
+  };
+
+  // Everything process() needs, resolved ahead of time and swapped in as a whole.
+  // Each module gets its own context here, in processing order, with its buffers set up by the graph.
   struct GraphProcessContext final
   {
+    std::vector<RenderOp> program;
     std::vector<ModuleRenderInfo> modules;
+    std::vector<std::unique_ptr<ModuleProcessContext>> moduleContexts;
+    std::vector<float> audioPool;
+    std::unique_ptr<bool[]> silenceFlags;
+    std::vector<size_t> numSilentSamples;
+    std::unique_ptr<EventMessage[]> eventPool;
+    std::atomic<size_t> numEventOverflows{0};
+    // every module in the graph, processed or not, sorted by id
+    std::vector<ParamTarget> paramTargets;
+
+    // for parallel processing
+    std::shared_ptr<WorkerPool> workerPool;
+    std::vector<std::unique_ptr<WorkStealingQueue>> queues;
+    std::unique_ptr<std::atomic<size_t>[]> numPendingInputs;
+    std::atomic<size_t> numRemaining{0};
   };
 
-  static void processModule(ModuleRenderInfo& m);
+  class ParallelProcessJob;
+
+  static void runProgram(const RenderOp* op, const RenderOp* end);
+
+  static void processModulesParallel(GraphProcessContext& context);
 
   void updateGraphProcessContext();
 
-  ModuleRenderInfo makeModuleRenderInfo(Module& m);
+  // from the audio thread, hands the param changes that land in the next block to their params
+  void applyParamChanges(const GraphProcessContext& context, size_t blockSize) const;
+
+  void retireReleasedParams(Module& m);
+
+  static std::unique_ptr<ModuleProcessContext> makeModuleContext(const Module& m);
+
+  static AudioAlias findAudioAlias(const Module& m, size_t step, const std::vector<Connection>& inputConnections,
+                                   const std::unordered_map<size_t, size_t>& stepsById,
+                                   const GraphProcessContext& context);
+
+  void allocateAudioBuffers(GraphProcessContext& context, const std::vector<AudioAlias>& aliases,
+                            const std::unordered_map<size_t, size_t>& stepsById, std::vector<bool*>& silenceFlagsOut,
+                            std::vector<bool>& sharesMemoryOut);
+
+  void allocateEventBuffers(GraphProcessContext& context);
+
+  static void compileModule(Module& m, size_t step, bool isAudioAlias, bool sharesMemory,
+                            const std::vector<Connection>& inputConnections,
+                            const std::unordered_map<size_t, size_t>& stepsById, const std::vector<bool*>& silenceFlags,
+                            GraphProcessContext& context, std::vector<size_t>& upstreamsOut);
 
   GraphIoModule _inputModule;
   GraphIoModule _outputModule;
   std::vector<std::unique_ptr<Module>> _modules;
+  // where each module is in _modules, by id
+  std::unordered_map<size_t, size_t> _moduleIndices;
   std::vector<Connection> _allConnections;
-  std::shared_ptr<GraphProcessContext> _graphProcessContext;
+  // where each connection is in _allConnections
+  std::unordered_map<Connection, size_t, ConnectionHash> _connectionIndices;
+  std::unordered_map<size_t, ModuleConnections> _moduleConnections;
+  GraphTopology _topology;
+  std::atomic<GraphProcessContext*> _graphProcessContext{nullptr};
+  std::shared_ptr<GraphProcessContext> _graphProcessContextOwner;
   std::vector<std::unique_ptr<Module>> _modulesToRelease;
+  bool _graphProcessContextDirty = false;
+  bool _applyingDeferredEdits = false;
+  std::shared_ptr<WorkerPool> _workerPool;
+  size_t _numWorkerThreads = 0;
+  size_t _pooledAudioMemory = 0;
+  size_t _unpooledAudioMemory = 0;
+  size_t _eventChannelCapacity = DEFAULT_EVENT_CHANNEL_CAPACITY;
+  size_t _eventPoolMemory = 0;
+  mutable Reclaimer _reclaimer;
+  mutable MultiProducerMessageQueue<ParamChange> _paramChanges{PARAM_CHANGE_QUEUE_SIZE};
+  // the audio thread's, for changes that have come in but aren't due yet, in order of time
+  mutable std::vector<ParamChange> _pendingParamChanges;
+  mutable std::atomic<uint64_t> _sampleTime{0};
 
   size_t _nextModuleId = 3; // reserve 0 for invalid, 1 and 2 for in and out
 };
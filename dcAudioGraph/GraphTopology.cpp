@@ -0,0 +1,398 @@
+#include "GraphTopology.h"
+#include <algorithm>
+#include <limits>
+
+const size_t dc::GraphTopology::INVALID_ID = std::numeric_limits<size_t>::max();
+
+bool dc::GraphTopology::addNode(size_t id)
+{
+  if (hasNode(id) || id == INVALID_ID)
+  {
+    return false;
+  }
+
+  // new nodes have no edges, so the end of the order is as good as anywhere
+  Node node;
+  node.position = _order.size();
+  _nodes.emplace(id, std::move(node));
+  _order.push_back(id);
+
+  return true;
+}
+
+bool dc::GraphTopology::removeNode(size_t id)
+{
+  auto it = _nodes.find(id);
+  if (it == _nodes.end())
+  {
+    return false;
+  }
+
+  auto& node = it->second;
+
+  // whatever fed this node loses it as a live output
+  if (node.isLive())
+  {
+    node.numSinkMarks = 0;
+    node.numLiveOutputs = 0;
+    propagateLiveness(id, false);
+  }
+
+  for (auto& e : node.inputs)
+  {
+    auto& other = _nodes[e.id].outputs;
+    other.erase(std::remove_if(other.begin(), other.end(), [id](const Edge& o) { return o.id == id; }), other.end());
+  }
+  for (auto& e : node.outputs)
+  {
+    auto& other = _nodes[e.id].inputs;
+    other.erase(std::remove_if(other.begin(), other.end(), [id](const Edge& o) { return o.id == id; }), other.end());
+  }
+
+  // leave a hole in the order, and tidy up once there are enough of them
+  _order[node.position] = INVALID_ID;
+  ++_numHoles;
+  _nodes.erase(it);
+
+  if (_numHoles > _order.size() / 2)
+  {
+    compact();
+  }
+
+  return true;
+}
+
+bool dc::GraphTopology::addEdge(size_t from, size_t to)
+{
+  auto fromIt = _nodes.find(from);
+  auto toIt = _nodes.find(to);
+  if (fromIt == _nodes.end() || toIt == _nodes.end() || from == to)
+  {
+    return false;
+  }
+
+  auto& fromNode = fromIt->second;
+  auto& toNode = toIt->second;
+
+  // if the edge already exists, it's already accounted for in the order
+  if (incrementEdge(fromNode.outputs, to))
+  {
+    incrementEdge(toNode.inputs, from);
+    if (toNode.isLive())
+    {
+      ++fromNode.numLiveOutputs;
+    }
+    return true;
+  }
+
+  // only the nodes between the two ends of the edge can be out of order
+  const size_t lowerBound = toNode.position;
+  const size_t upperBound = fromNode.position;
+  if (lowerBound < upperBound)
+  {
+    _visited.clear();
+    _forward.clear();
+    _backward.clear();
+
+    if (searchForward(to, upperBound, from))
+    {
+      return false;
+    }
+    searchBackward(from, lowerBound);
+    reorder();
+  }
+
+  fromNode.outputs.push_back({to, 1});
+  toNode.inputs.push_back({from, 1});
+
+  if (toNode.isLive())
+  {
+    const bool wasLive = fromNode.isLive();
+    ++fromNode.numLiveOutputs;
+    if (!wasLive)
+    {
+      propagateLiveness(from, true);
+    }
+  }
+  return true;
+}
+
+bool dc::GraphTopology::removeEdge(size_t from, size_t to)
+{
+  auto fromIt = _nodes.find(from);
+  auto toIt = _nodes.find(to);
+  if (fromIt == _nodes.end() || toIt == _nodes.end())
+  {
+    return false;
+  }
+
+  // removing an edge never invalidates the order
+  auto& fromNode = fromIt->second;
+  if (!removeFromEdges(fromNode.outputs, to) || !removeFromEdges(toIt->second.inputs, from))
+  {
+    return false;
+  }
+
+  if (toIt->second.isLive())
+  {
+    --fromNode.numLiveOutputs;
+    if (!fromNode.isLive())
+    {
+      propagateLiveness(from, false);
+    }
+  }
+  return true;
+}
+
+bool dc::GraphTopology::edgeCreatesCycle(size_t from, size_t to)
+{
+  if (from == to)
+  {
+    return true;
+  }
+
+  auto fromIt = _nodes.find(from);
+  auto toIt = _nodes.find(to);
+  if (fromIt == _nodes.end() || toIt == _nodes.end())
+  {
+    return false;
+  }
+
+  // anything reachable from a node comes after it in the order
+  if (toIt->second.position > fromIt->second.position)
+  {
+    return false;
+  }
+
+  _visited.clear();
+  _forward.clear();
+  return searchForward(to, fromIt->second.position, from);
+}
+
+void dc::GraphTopology::getOrder(std::vector<size_t>& orderOut) const
+{
+  orderOut.clear();
+  orderOut.reserve(_nodes.size());
+  for (auto id : _order)
+  {
+    if (id != INVALID_ID)
+    {
+      orderOut.push_back(id);
+    }
+  }
+}
+
+bool dc::GraphTopology::addSink(size_t id)
+{
+  auto it = _nodes.find(id);
+  if (it == _nodes.end())
+  {
+    return false;
+  }
+
+  const bool wasLive = it->second.isLive();
+  ++it->second.numSinkMarks;
+  if (!wasLive)
+  {
+    propagateLiveness(id, true);
+  }
+  return true;
+}
+
+bool dc::GraphTopology::removeSink(size_t id)
+{
+  auto it = _nodes.find(id);
+  if (it == _nodes.end() || it->second.numSinkMarks == 0)
+  {
+    return false;
+  }
+
+  --it->second.numSinkMarks;
+  if (!it->second.isLive())
+  {
+    propagateLiveness(id, false);
+  }
+  return true;
+}
+
+bool dc::GraphTopology::isLive(size_t id) const
+{
+  auto it = _nodes.find(id);
+  return it != _nodes.end() && it->second.isLive();
+}
+
+void dc::GraphTopology::getLiveOrder(std::vector<size_t>& orderOut) const
+{
+  orderOut.clear();
+  for (auto id : _order)
+  {
+    if (id != INVALID_ID && _nodes.at(id).isLive())
+    {
+      orderOut.push_back(id);
+    }
+  }
+}
+
+void dc::GraphTopology::clear()
+{
+  _nodes.clear();
+  _order.clear();
+  _numHoles = 0;
+}
+
+bool dc::GraphTopology::incrementEdge(std::vector<Edge>& edges, size_t id)
+{
+  for (auto& e : edges)
+  {
+    if (e.id == id)
+    {
+      ++e.count;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool dc::GraphTopology::removeFromEdges(std::vector<Edge>& edges, size_t id)
+{
+  for (auto it = edges.begin(); it != edges.end(); ++it)
+  {
+    if (it->id == id)
+    {
+      if (--it->count == 0)
+      {
+        edges.erase(it);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool dc::GraphTopology::searchForward(size_t id, size_t upperBound, size_t target)
+{
+  // iterative, so big graphs don't blow the stack
+  std::vector<size_t> stack{id};
+  _visited.insert(id);
+
+  while (!stack.empty())
+  {
+    const size_t current = stack.back();
+    stack.pop_back();
+    _forward.push_back(current);
+    ++_numNodesVisited;
+
+    for (auto& e : _nodes[current].outputs)
+    {
+      if (e.id == target)
+      {
+        return true;
+      }
+      if (_nodes[e.id].position < upperBound && _visited.insert(e.id).second)
+      {
+        stack.push_back(e.id);
+      }
+    }
+  }
+
+  return false;
+}
+
+void dc::GraphTopology::searchBackward(size_t id, size_t lowerBound)
+{
+  std::vector<size_t> stack{id};
+  _visited.insert(id);
+
+  while (!stack.empty())
+  {
+    const size_t current = stack.back();
+    stack.pop_back();
+    _backward.push_back(current);
+    ++_numNodesVisited;
+
+    for (auto& e : _nodes[current].inputs)
+    {
+      if (_nodes[e.id].position > lowerBound && _visited.insert(e.id).second)
+      {
+        stack.push_back(e.id);
+      }
+    }
+  }
+}
+
+void dc::GraphTopology::reorder()
+{
+  auto byPosition = [this](size_t a, size_t b) { return _nodes[a].position < _nodes[b].position; };
+  std::sort(_forward.begin(), _forward.end(), byPosition);
+  std::sort(_backward.begin(), _backward.end(), byPosition);
+
+  // reuse the positions of the affected nodes, with everything that reaches the new edge first
+  _positions.clear();
+  for (auto id : _backward)
+  {
+    _positions.push_back(_nodes[id].position);
+  }
+  for (auto id : _forward)
+  {
+    _positions.push_back(_nodes[id].position);
+  }
+  std::sort(_positions.begin(), _positions.end());
+
+  size_t i = 0;
+  for (auto id : _backward)
+  {
+    _nodes[id].position = _positions[i];
+    _order[_positions[i++]] = id;
+  }
+  for (auto id : _forward)
+  {
+    _nodes[id].position = _positions[i];
+    _order[_positions[i++]] = id;
+  }
+}
+
+void dc::GraphTopology::propagateLiveness(size_t id, bool isLive)
+{
+  // iterative, so big graphs don't blow the stack
+  std::vector<size_t> stack{id};
+
+  while (!stack.empty())
+  {
+    const size_t current = stack.back();
+    stack.pop_back();
+
+    for (auto& e : _nodes[current].inputs)
+    {
+      auto& input = _nodes[e.id];
+      const bool wasLive = input.isLive();
+      if (isLive)
+      {
+        input.numLiveOutputs += e.count;
+      }
+      else
+      {
+        input.numLiveOutputs -= e.count;
+      }
+
+      if (input.isLive() != wasLive)
+      {
+        stack.push_back(e.id);
+      }
+    }
+  }
+}
+
+void dc::GraphTopology::compact()
+{
+  size_t position = 0;
+  for (auto id : _order)
+  {
+    if (id != INVALID_ID)
+    {
+      _nodes[id].position = position;
+      _order[position++] = id;
+    }
+  }
+  _order.resize(position);
+  _numHoles = 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Keeps track of which modules feed which, and keeps them in a valid processing order.
+ * The order is maintained incrementally (Pearce-Kelly), so adding an edge only touches
+ * the nodes between its two ends in the current order, instead of re-sorting everything.
+ * It also keeps track of which nodes are live, meaning they're a sink or feed one.
+ * That's maintained incrementally too, by counting each node's edges to live nodes,
+ * so an edit only touches the nodes whose liveness actually changes.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dc
+{
+class GraphTopology final
+{
+public:
+  // returns false if the node already exists
+  bool addNode(size_t id);
+
+  // removes the node and any edges to or from it
+  bool removeNode(size_t id);
+
+  bool hasNode(size_t id) const { return _nodes.count(id) > 0; }
+
+  size_t getNumNodes() const { return _nodes.size(); }
+
+  // Adds an edge, and reorders the nodes if needed.
+  // Multiple edges between the same nodes are counted, and have to be removed as many times.
+  // Returns false, and doesn't add the edge, if it would create a cycle.
+  bool addEdge(size_t from, size_t to);
+
+  // returns false if there is no such edge
+  bool removeEdge(size_t from, size_t to);
+
+  // check if adding an edge would create a cycle
+  bool edgeCreatesCycle(size_t from, size_t to);
+
+  // get the nodes in an order where every node comes after all of its inputs
+  void getOrder(std::vector<size_t>& orderOut) const;
+
+  // Mark a node as a sink, which is always live.
+  // Sinks are counted, so a node marked more than once has to be unmarked as many times.
+  bool addSink(size_t id);
+
+  bool removeSink(size_t id);
+
+  // true if the node is a sink, or feeds one
+  bool isLive(size_t id) const;
+
+  // same as getOrder(), with only the live nodes
+  void getLiveOrder(std::vector<size_t>& orderOut) const;
+
+  void clear();
+
+  // How many nodes the searches for reordering and cycles have visited, in total.
+  // It's what an edit costs, so it should depend on the edit, not on how big the graph is.
+  size_t getNumNodesVisited() const { return _numNodesVisited; }
+
+private:
+  struct Edge
+  {
+    size_t id;
+    size_t count;
+  };
+
+  struct Node
+  {
+    size_t position = 0;
+    std::vector<Edge> inputs;
+    std::vector<Edge> outputs;
+    size_t numSinkMarks = 0;
+    size_t numLiveOutputs = 0;
+
+    bool isLive() const { return numSinkMarks > 0 || numLiveOutputs > 0; }
+  };
+
+  static bool incrementEdge(std::vector<Edge>& edges, size_t id);
+
+  static bool removeFromEdges(std::vector<Edge>& edges, size_t id);
+
+  bool searchForward(size_t id, size_t upperBound, size_t target);
+
+  void searchBackward(size_t id, size_t lowerBound);
+
+  void reorder();
+
+  // pass a change in a node's liveness on to its inputs, and theirs, for as far as it goes
+  void propagateLiveness(size_t id, bool isLive);
+
+  void compact();
+
+  static const size_t INVALID_ID;
+
+  std::unordered_map<size_t, Node> _nodes;
+  std::vector<size_t> _order;
+  size_t _numHoles = 0;
+
+  // scratch space for reordering, kept around to avoid reallocating
+  std::vector<size_t> _forward;
+  std::vector<size_t> _backward;
+  std::vector<size_t> _positions;
+  std::unordered_set<size_t> _visited;
+  size_t _numNodesVisited = 0;
+};
+}
@@ -26,6 +26,11 @@ protected:
 
   void process(ModuleProcessContext& context) override;
 
+  bool isAudioReadOnly() const override { return true; }
+
+  // the levels go out to the GUI, whether or not anything is connected downstream
+  bool hasSideEffects() const override { return true; }
+
   bool wantsMessage() const { return _levelMessageQueue.empty(); }
 
   bool pushLevelMessage(const LevelMessage& msg);
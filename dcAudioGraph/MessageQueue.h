@@ -1,6 +1,16 @@
+/*
+ * A bounded queue for passing messages from one thread to one other thread, without locks.
+ * The producer only writes the tail, and the consumer only writes the head, each on its own cache line.
+ * Each side keeps a copy of the other's index, and only reloads it when the queue looks full or empty,
+ * so the two threads mostly leave each other's cache lines alone.
+ * The storage is rounded up to a power of two, so wrapping around is a mask.
+ */
+
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <memory>
 
 namespace dc
 {
@@ -10,12 +20,13 @@ class MessageQueue final
 public:
   explicit MessageQueue(size_t maxSize) : _maxSize(maxSize)
   {
-    _data = static_cast<MessageType*>(malloc(maxSize * sizeof(MessageType)));
-  }
-
-  ~MessageQueue()
-  {
-    free(_data);
+    size_t storageSize = 1;
+    while (storageSize < maxSize)
+    {
+      storageSize <<= 1;
+    }
+    _data.reset(new MessageType[storageSize]);
+    _mask = storageSize - 1;
   }
 
   // no copy/move
@@ -27,41 +38,106 @@ public:
 
   MessageQueue& operator=(MessageQueue&&) = delete;
 
-  bool empty() const { return _size.load() == 0; }
+  // these can be called from either side, and are out of date as soon as they return
+  bool empty() const { return numMessages() == 0; }
 
-  bool full() const { return _size.load() >= _maxSize; }
+  bool full() const { return numMessages() >= _maxSize; }
+
+  size_t numMessages() const
+  {
+    const size_t head = _consumer.head.load(std::memory_order_acquire);
+    return _producer.tail.load(std::memory_order_acquire) - head;
+  }
 
-  size_t numMessages() const { return _size.load(); }
+  size_t capacity() const { return _maxSize; }
 
+  // producer side
   bool push(const MessageType& msg)
   {
-    if (_size.load(std::memory_order_acquire) < _maxSize)
+    return pushBatch(&msg, 1) == 1;
+  }
+
+  // Pushes as many of the messages as fit, in order, and returns how many that was.
+  // The consumer sees them all at once.
+  size_t pushBatch(const MessageType* msgs, size_t numMsgs)
+  {
+    auto& p = _producer;
+    const size_t tail = p.tail.load(std::memory_order_relaxed);
+    size_t space = _maxSize - (tail - p.cachedHead);
+    if (space < numMsgs)
     {
-      _data[_tail] = msg;
-      _tail = (_tail + 1) % _maxSize;
-      _size.fetch_add(1, std::memory_order_release);
-      return true;
+      p.cachedHead = _consumer.head.load(std::memory_order_acquire);
+      space = _maxSize - (tail - p.cachedHead);
     }
-    return false;
+
+    const size_t numToPush = numMsgs < space ? numMsgs : space;
+    for (size_t i = 0; i < numToPush; ++i)
+    {
+      _data[(tail + i) & _mask] = msgs[i];
+    }
+    if (numToPush > 0)
+    {
+      p.tail.store(tail + numToPush, std::memory_order_release);
+    }
+    return numToPush;
   }
 
+  // consumer side
   bool pop(MessageType& msg)
   {
-    if (_size.load(std::memory_order_acquire) > 0)
+    return popBatch(&msg, 1) == 1;
+  }
+
+  // pops up to maxMsgs messages, in order, and returns how many there were
+  size_t popBatch(MessageType* msgsOut, size_t maxMsgs)
+  {
+    auto& c = _consumer;
+    const size_t head = c.head.load(std::memory_order_relaxed);
+    size_t available = c.cachedTail - head;
+    if (available < maxMsgs)
     {
-      msg = _data[_head];
-      _head = (_head + 1) % _maxSize;
-      _size.fetch_sub(1, std::memory_order_release);
-      return true;
+      c.cachedTail = _producer.tail.load(std::memory_order_acquire);
+      available = c.cachedTail - head;
     }
-    return false;
+
+    const size_t numToPop = maxMsgs < available ? maxMsgs : available;
+    for (size_t i = 0; i < numToPop; ++i)
+    {
+      msgsOut[i] = _data[(head + i) & _mask];
+    }
+    if (numToPop > 0)
+    {
+      c.head.store(head + numToPop, std::memory_order_release);
+    }
+    return numToPop;
   }
 
 private:
-  MessageType* _data = nullptr;
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  // The indices only ever go up, and wrap around with size_t.
+  // The padding keeps each side's line to itself, without needing over-aligned allocations.
+  struct Consumer
+  {
+    std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+    char padding[CACHE_LINE_SIZE];
+  };
+
+  struct Producer
+  {
+    std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    char padding[CACHE_LINE_SIZE];
+  };
+
+  // only read once set up
+  std::unique_ptr<MessageType[]> _data;
+  size_t _mask = 0;
   const size_t _maxSize;
-  std::atomic<size_t> _size{0};
-  size_t _head = 0;
-  size_t _tail = 0;
+  char _padding[CACHE_LINE_SIZE];
+
+  Consumer _consumer;
+  Producer _producer;
 };
 }
@@ -1,5 +1,6 @@
 #include "Module.h"
 #include <algorithm>
+#include "Graph.h"
 
 void dc::Module::setSampleRate(double sampleRate)
 {
@@ -256,6 +257,15 @@ void dc::Module::setEventIoFilters(IoType type, size_t index, EventMessage::Type
   }
 }
 
+void dc::Module::setTailLength(size_t numSamples)
+{
+  if (numSamples != _tailLength)
+  {
+    _tailLength = numSamples;
+    updateProcessContext();
+  }
+}
+
 bool dc::Module::addParam(const std::string& id, const std::string& displayName, const ParamRange& range,
                           bool serializable, bool hasControlInput, float initialValue)
 {
@@ -305,25 +315,77 @@ void dc::Module::updateParams(ModuleProcessContext& context)
 
     if (param->hasControlInput())
     {
-      if (context.eventBuffer.getNumMessages(param->getControlInputIndex()))
+      const auto* channel = context.eventBuffer.getChannel(param->getControlInputIndex());
+      if (nullptr != channel && channel->size() > 0)
       {
-        auto it = context.eventBuffer.getIterator(param->getControlInputIndex());
-        EventMessage msg;
-        while (it.next(msg))
+        for (const auto& msg : *channel)
         {
-          param->setControlInput(msg.floatParam.value);
+          param->addControlInput(msg.sampleOffset, msg.floatParam.value);
         }
       }
       else
       {
-        param->setControlInput(0.0f);
+        param->noControlInput();
       }
     }
   }
 }
 
+float* dc::Module::getSmoothedParam(ModuleProcessContext& context, size_t paramIndex)
+{
+  float* values = context.paramBuffer.getChannelPointer(paramIndex);
+  context.params[paramIndex]->getSmoothedRaw(values, context.blockSize);
+  return values;
+}
+
+void dc::Module::beginEdit()
+{
+  ++_editDepth;
+}
+
+void dc::Module::commitEdit()
+{
+  if (_editDepth == 0)
+  {
+    return;
+  }
+
+  if (--_editDepth == 0)
+  {
+    applyDeferredEdits();
+  }
+}
+
+bool dc::Module::isEditing() const
+{
+  return _editDepth > 0 || (nullptr != _graph && _graph->isEditing());
+}
+
+void dc::Module::applyDeferredEdits()
+{
+  // the graph we're in is still being edited, so it'll apply our changes when it's done
+  if (isEditing())
+  {
+    return;
+  }
+
+  if (_processContextDirty)
+  {
+    updateProcessContext();
+  }
+  editCommitted();
+}
+
 void dc::Module::updateProcessContext()
 {
+  // wait for the edit to finish
+  if (isEditing())
+  {
+    _processContextDirty = true;
+    return;
+  }
+  _processContextDirty = false;
+
   auto newContext = std::make_shared<ModuleProcessContext>();
 
   newContext->numAudioIn = _audioInputs.size();
@@ -332,21 +394,26 @@ void dc::Module::updateProcessContext()
   newContext->numEventOut = _eventOutputs.size();
   newContext->blockSize = _blockSize;
   newContext->sampleRate = _sampleRate;
-  newContext->audioBuffer.resize(_blockSize, std::max(_audioInputs.size(), _audioOutputs.size()));
-  newContext->eventBuffer.setNumChannels(std::max(_eventInputs.size(), _eventOutputs.size()));
+  newContext->tailLength = _tailLength;
+  // the buffers are left empty, the graph sets them up in its own copy of the context
   for (auto& p : _params)
   {
     newContext->params.push_back(p.get());
   }
 
-  // swap in the new context
-  newContext = std::atomic_exchange(&_processContext, newContext);
-  // spin here in case process() is still using the old context
-  while (newContext.use_count() > 1)
-  {}
+  _processContext = std::move(newContext);
 
-  // now that the old context is gone, we can clear the released params
-  _paramsToRelease.clear();
+  // If we're in a graph, it picks up the new context when it rebuilds its own,
+  // and frees the old one and any released params once its process() is done with them.
+  // Otherwise, nothing else can be using them.
+  if (nullptr != _graph)
+  {
+    _graph->updateGraphProcessContext();
+  }
+  else
+  {
+    _paramsToRelease.clear();
+  }
 }
 
 dc::Module::Io* dc::Module::getIo(IoType typeFlags, size_t index)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <memory>
 #include "AudioBuffer.h"
 #include "EventBuffer.h"
@@ -34,6 +35,9 @@ const size_t MODULE_MAX_MESSAGES = 32;
 const size_t MODULE_DEFAULT_MAX_IO = 32;
 const size_t MODULE_DEFAULT_MAX_PARAMS = 32;
 const size_t MODULE_DEFAULT_MAX_BLOCK_SIZE = 2048;
+const size_t MODULE_INFINITE_TAIL = std::numeric_limits<size_t>::max();
+
+class Graph;
 
 class Module
 {
@@ -95,7 +99,26 @@ public:
 
   ModuleParam* getParam(const std::string& id);
 
+  // How long the module keeps making sound after its inputs go silent, in samples.
+  // Once every input has been silent for longer than this, with no events coming in,
+  // the graph stops calling process() and leaves the output silent until something comes in again.
+  // The default of MODULE_INFINITE_TAIL means process() is always called.
+  size_t getTailLength() const { return _tailLength; }
+
+  // Edits
+  // Changes made between beginEdit() and commitEdit() are applied all at once, when the edit is committed.
+  // Edits can be nested, and only the outermost commitEdit() applies the changes.
+  // If the module is in a graph that's being edited, its changes wait for the graph's edit too.
+  void beginEdit();
+
+  void commitEdit();
+
+  bool isEditing() const;
+
 protected:
+  // Everything process() gets to work with.
+  // The graph sets up the buffers, and the audio buffer can share memory with other modules' buffers,
+  // so don't count on it holding on to anything between calls to process().
   struct ModuleProcessContext
   {
     size_t numAudioIn;
@@ -104,21 +127,37 @@ protected:
     size_t numEventOut;
     size_t blockSize;
     double sampleRate;
+    size_t tailLength;
     AudioBuffer audioBuffer;
     EventBuffer eventBuffer;
     std::vector<ModuleParam*> params;
+    // room for a block of each param's values, see getSmoothedParam()
+    AudioBuffer paramBuffer;
   };
 
   virtual void process(ModuleProcessContext& context);
 
+  // Return true if process() only ever reads the audio buffer.
+  // The graph can then hand the module its input straight out of the upstream module's buffer, without copying it.
+  virtual bool isAudioReadOnly() const { return false; }
+
+  // Return true if process() does anything besides writing its outputs, like sending messages to the outside world.
+  // The graph only processes modules that feed its output, or that have side effects.
+  virtual bool hasSideEffects() const { return false; }
+
   virtual void sampleRateChanged() {}
 
   virtual void blockSizeChanged() {}
 
   virtual void ioCountChanged(IoType type, size_t count);
 
+  // called when the outermost edit is committed, after the process context is updated
+  virtual void editCommitted() {}
+
   void setEventIoFilters(IoType type, size_t index, EventMessage::Type filters);
 
+  void setTailLength(size_t numSamples);
+
   // Params
   bool addParam(const std::string& id, const std::string& displayName,
                 const ParamRange& range,
@@ -129,6 +168,11 @@ protected:
   // for use in process() only
   static void updateParams(ModuleProcessContext& context);
 
+  // For use in process(), after updateParams().
+  // Renders a param's smoothed raw values for the whole block into the context, and returns them.
+  // They're yours until the end of process(), so it's fine to convert them in place.
+  static float* getSmoothedParam(ModuleProcessContext& context, size_t paramIndex);
+
 private:
   // I/O
   virtual bool setNumIoInternal(std::vector<Io>& io, size_t n);
@@ -139,10 +183,13 @@ private:
 
   void updateProcessContext();
 
+  void applyDeferredEdits();
+
   Io* getIo(IoType typeFlags, size_t index);
 
   double _sampleRate = 0;
   size_t _blockSize = 0;
+  size_t _tailLength = MODULE_INFINITE_TAIL;
   std::vector<Io> _audioInputs;
   std::vector<Io> _audioOutputs;
   std::vector<Io> _eventInputs;
@@ -150,8 +197,27 @@ private:
   std::vector<std::unique_ptr<ModuleParam>> _params;
   std::vector<std::unique_ptr<ModuleParam>> _paramsToRelease;
   std::shared_ptr<ModuleProcessContext> _processContext;
+  size_t _editDepth = 0;
+  bool _processContextDirty = false;
 
   // for the Graph
   size_t _id = 0;
+  Graph* _graph = nullptr;
+};
+
+// Begins an edit on construction, and commits it on destruction.
+class ScopedEdit final
+{
+public:
+  explicit ScopedEdit(Module& module) : _module(module) { _module.beginEdit(); }
+
+  ~ScopedEdit() { _module.commitEdit(); }
+
+  ScopedEdit(const ScopedEdit&) = delete;
+
+  ScopedEdit& operator=(const ScopedEdit&) = delete;
+
+private:
+  Module& _module;
 };
 }
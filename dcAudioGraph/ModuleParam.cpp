@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cmath>
 #include <utility>
+#include "AudioKernels.h"
 #include "ModuleParam.h"
 
 dc::ParamRange::ParamRange(float min, float max, float stepSize, float sliderSkew) :
@@ -35,6 +36,9 @@ dc::ParamRange& dc::ParamRange::operator=(const ParamRange& other)
     _sliderSkew = other._sliderSkew;
     _getNormalized = other._getNormalized;
     _getRaw = other._getRaw;
+    _getValue = other._getValue;
+    _rawTable = other._rawTable;
+    _valueTable = other._valueTable;
   }
   return *this;
 }
@@ -53,6 +57,103 @@ float dc::ParamRange::getRaw(float normalizedValue) const
   return constrained;
 }
 
+void dc::ParamRange::getRaw(const float* normalizedValues, float* rawOut, size_t numValues) const
+{
+  // copies, so the compiler knows writing to rawOut can't change them
+  const float min = _min;
+  const float max = _max;
+  const float stepSize = _stepSize;
+
+  // the linear conversion is simple enough for the compiler to vectorize, so skip the call through the pointer
+  if (nullptr != _rawTable)
+  {
+    _rawTable->lookup(normalizedValues, rawOut, numValues);
+  }
+  else if (_getRaw == getRawLinear)
+  {
+    const float range = max - min;
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      rawOut[i] = min + range * normalizedValues[i];
+    }
+  }
+  else
+  {
+    const auto getRawFn = _getRaw;
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      rawOut[i] = getRawFn(normalizedValues[i], min, max);
+    }
+  }
+
+  // constrainRaw(), with the branches taken once for the block
+  if (max > min)
+  {
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      rawOut[i] = std::min(max, std::max(min, rawOut[i]));
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      rawOut[i] = std::max(max, std::min(min, rawOut[i]));
+    }
+  }
+
+  if (stepSize > 0.0f)
+  {
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      rawOut[i] = stepSize * std::floor(rawOut[i] / stepSize + 0.5f);
+    }
+  }
+}
+
+void dc::ParamRange::buildTables(size_t numPoints, GetValueFn getValue)
+{
+  const float min = _min;
+  const float max = _max;
+  const auto getRaw = _getRaw;
+  _rawTable = std::make_shared<CurveTable>([=](float x) { return getRaw(x, min, max); }, 0.0f, 1.0f, numPoints);
+
+  _getValue = getValue;
+  if (nullptr != getValue && _max != _min)
+  {
+    _valueTable = std::make_shared<CurveTable>(getValue, _min, _max, numPoints);
+  }
+  else
+  {
+    _valueTable.reset();
+  }
+}
+
+float dc::ParamRange::getValue(float rawValue) const
+{
+  return nullptr != _getValue ? _getValue(rawValue) : rawValue;
+}
+
+void dc::ParamRange::getValue(const float* rawValues, float* valuesOut, size_t numValues) const
+{
+  if (nullptr != _valueTable)
+  {
+    _valueTable->lookup(rawValues, valuesOut, numValues);
+  }
+  else if (nullptr != _getValue)
+  {
+    const auto getValueFn = _getValue;
+    for (size_t i = 0; i < numValues; ++i)
+    {
+      valuesOut[i] = getValueFn(rawValues[i]);
+    }
+  }
+  else if (rawValues != valuesOut)
+  {
+    std::copy(rawValues, rawValues + numValues, valuesOut);
+  }
+}
+
 float dc::ParamRange::constrainRaw(float rawValue) const
 {
   const float clamped = clampToRange(rawValue, _min, _max);
@@ -109,7 +210,8 @@ dc::ModuleParam::ModuleParam(const ModuleParam& other) :
     _range(other._range),
     _serializable(other._serializable),
     _controlInputIndex(other._controlInputIndex),
-    _value(other._value.load())
+    _value(other._value.load()),
+    _sampleAccurate(other._sampleAccurate.load())
 {
   initSmoothing();
 }
@@ -124,6 +226,7 @@ dc::ModuleParam& dc::ModuleParam::operator=(const ModuleParam& other)
     _serializable = other._serializable;
     _controlInputIndex = other._controlInputIndex;
     _value = other._value.load();
+    _sampleAccurate = other._sampleAccurate.load();
   }
   return *this;
 }
@@ -153,6 +256,11 @@ void dc::ModuleParam::setControlInput(float value)
   _controlInput = std::max(0.0f, std::min(1.0f, value));
 }
 
+void dc::ModuleParam::setSampleAccurate(bool sampleAccurate)
+{
+  _sampleAccurate = sampleAccurate;
+}
+
 void dc::ModuleParam::initSmoothing()
 {
   _normStart = getNormalized();
@@ -164,6 +272,11 @@ void dc::ModuleParam::initSmoothing()
   _inputStart = getControlInput();
   _inputEnd = _inputStart;
   _inputInc = 0.0f;
+  _numControlPoints = 0;
+  _inputMoving = false;
+  _numScheduledPoints = 0;
+  _numValuePoints = 0;
+  _valueMoving = false;
 }
 
 void dc::ModuleParam::updateSmoothing(size_t numSamples)
@@ -171,22 +284,230 @@ void dc::ModuleParam::updateSmoothing(size_t numSamples)
   _normStart = _normEnd;
   _normEnd = getNormalized();
   _normInc = (_normEnd - _normStart) / numSamples;
+  _numValuePoints = 0;
+  _valueMoving = false;
+  if (_numScheduledPoints > 0)
+  {
+    // the scheduled values take over from smoothing over the whole block
+    for (size_t i = 0; i < _numScheduledPoints; ++i)
+    {
+      auto point = _scheduledPoints[i];
+      point.sampleOffset = std::min(numSamples, point.sampleOffset);
+      _valuePoints[_numValuePoints++] = point;
+      _valueMoving = _valueMoving || point.value != _normStart;
+    }
+    _numScheduledPoints = 0;
+    _normEnd = _valuePoints[_numValuePoints - 1].value;
+    _normInc = 0.0f;
+  }
   _ctNormStart = _ctNormEnd;
   _ctNormEnd = _range.getNormalized(_controlTarget);
   _ctNormInc = (_ctNormEnd - _ctNormStart) / numSamples;
   _inputStart = _inputEnd;
+  _blockSize = numSamples;
+  _blockSampleAccurate = _sampleAccurate;
+  _numControlPoints = 0;
+  _inputMoving = false;
+  if (_blockSampleAccurate)
+  {
+    // the control points for this block come in after this
+    _inputInc = 0.0f;
+  }
+  else
+  {
+    _inputEnd = _controlInput;
+    _inputInc = (_inputEnd - _inputStart) / numSamples;
+    _inputMoving = _inputInc != 0.0f;
+  }
+}
+
+void dc::ModuleParam::addControlInput(size_t sampleOffset, float value)
+{
+  setControlInput(value);
+  if (!_blockSampleAccurate)
+  {
+    return;
+  }
+
+  addPoint(_controlPoints.data(), _numControlPoints, std::min(_blockSize, sampleOffset), _controlInput);
   _inputEnd = _controlInput;
-  _inputInc = (_inputEnd - _inputStart) / numSamples;
+  _inputMoving = _inputMoving || _inputEnd != _inputStart;
+}
+
+void dc::ModuleParam::noControlInput()
+{
+  if (!_blockSampleAccurate)
+  {
+    setControlInput(0.0f);
+  }
+}
+
+void dc::ModuleParam::scheduleRaw(size_t sampleOffset, float rawValue)
+{
+  setRaw(rawValue);
+  addPoint(_scheduledPoints.data(), _numScheduledPoints, sampleOffset, getNormalized());
+}
+
+void dc::ModuleParam::skipBlock()
+{
+  if (_numScheduledPoints > 0)
+  {
+    _numScheduledPoints = 0;
+    _numValuePoints = 0;
+    _valueMoving = false;
+    _normStart = getNormalized();
+    _normEnd = _normStart;
+    _normInc = 0.0f;
+  }
+}
+
+float dc::ModuleParam::getSteppedValue(float start, const ControlPoint* points, size_t numPoints,
+                                       size_t sampleOffset)
+{
+  float value = start;
+  for (size_t i = 0; i < numPoints && points[i].sampleOffset <= sampleOffset; ++i)
+  {
+    value = points[i].value;
+  }
+  return value;
+}
+
+void dc::ModuleParam::renderSteps(float* out, float start, const ControlPoint* points, size_t numPoints,
+                                  size_t sampleOffset, size_t numSamples)
+{
+  // getSteppedValue() for a chunk of the block, a flat run at a time
+  const auto& kernels = getAudioKernels();
+  const size_t end = sampleOffset + numSamples;
+  float value = start;
+  size_t pos = sampleOffset;
+
+  for (size_t i = 0; i < numPoints; ++i)
+  {
+    const auto& point = points[i];
+    if (pos < point.sampleOffset)
+    {
+      const size_t runEnd = std::min(end, point.sampleOffset);
+      kernels.fill(out + (pos - sampleOffset), value, runEnd - pos);
+      pos = runEnd;
+      if (pos < point.sampleOffset)
+      {
+        return;
+      }
+    }
+    value = point.value;
+  }
+
+  kernels.fill(out + (pos - sampleOffset), value, end - pos);
+}
+
+void dc::ModuleParam::addPoint(ControlPoint* points, size_t& numPoints, size_t sampleOffset, float value)
+{
+  // in order, and when they're full the last one makes way
+  const size_t lastOffset = numPoints > 0 ? points[numPoints - 1].sampleOffset : 0;
+  if (numPoints == MAX_CONTROL_POINTS)
+  {
+    --numPoints;
+  }
+  points[numPoints++] = {std::max(lastOffset, sampleOffset), value};
+}
+
+float dc::ModuleParam::getSmoothedInput(size_t sampleOffset) const
+{
+  if (!_blockSampleAccurate)
+  {
+    return _inputStart + _inputInc * sampleOffset;
+  }
+  return getSteppedValue(_inputStart, _controlPoints.data(), _numControlPoints, sampleOffset);
+}
+
+void dc::ModuleParam::renderSmoothedInput(float* inputOut, size_t sampleOffset, size_t numSamples) const
+{
+  renderSteps(inputOut, _inputStart, _controlPoints.data(), _numControlPoints, sampleOffset, numSamples);
+}
+
+float dc::ModuleParam::getSmoothedNormalized(size_t sampleOffset) const
+{
+  if (_numValuePoints > 0)
+  {
+    return getSteppedValue(_normStart, _valuePoints.data(), _numValuePoints, sampleOffset);
+  }
+  return _normStart + _normInc * sampleOffset;
 }
 
 float dc::ModuleParam::getSmoothedRaw(size_t sampleOffset) const
 {
   if (hasControlInput())
   {
-    const float smoothed = _normStart + _normInc * sampleOffset;
+    const float smoothed = getSmoothedNormalized(sampleOffset);
     const float targetSmoothed = _ctNormStart + _ctNormInc * sampleOffset;
-    const float inputSmoothed = _inputStart + _inputInc * sampleOffset;
+    const float inputSmoothed = getSmoothedInput(sampleOffset);
     return _range.getRaw(smoothed + (targetSmoothed - smoothed) * inputSmoothed);
   }
-  return _range.getRaw(_normStart + _normInc * sampleOffset);
+  return _range.getRaw(getSmoothedNormalized(sampleOffset));
+}
+
+void dc::ModuleParam::getSmoothedRaw(float* rawOut, size_t numSamples) const
+{
+  const auto& kernels = getAudioKernels();
+
+  if (!isSmoothing())
+  {
+    kernels.fill(rawOut, getSmoothedRaw(0), numSamples);
+    return;
+  }
+
+  if (_numValuePoints > 0)
+  {
+    renderSteps(rawOut, _normStart, _valuePoints.data(), _numValuePoints, 0, numSamples);
+  }
+  else
+  {
+    kernels.ramp(rawOut, _normStart, _normInc, numSamples);
+  }
+
+  if (hasControlInput())
+  {
+    // the sample indices, a chunk at a time, so the blend is plain vectorizable math
+    const size_t chunkSize = 256;
+    float indices[chunkSize];
+    float inputs[chunkSize];
+    const float ctNormStart = _ctNormStart;
+    const float ctNormInc = _ctNormInc;
+    const float inputStart = _inputStart;
+    const float inputInc = _inputInc;
+    for (size_t offset = 0; offset < numSamples; offset += chunkSize)
+    {
+      const size_t n = std::min(chunkSize, numSamples - offset);
+      kernels.ramp(indices, static_cast<float>(offset), 1.0f, n);
+      if (_blockSampleAccurate)
+      {
+        renderSmoothedInput(inputs, offset, n);
+      }
+      else
+      {
+        for (size_t i = 0; i < n; ++i)
+        {
+          inputs[i] = inputStart + inputInc * indices[i];
+        }
+      }
+
+      float* smoothed = rawOut + offset;
+      for (size_t i = 0; i < n; ++i)
+      {
+        const float targetSmoothed = ctNormStart + ctNormInc * indices[i];
+        smoothed[i] = smoothed[i] + (targetSmoothed - smoothed[i]) * inputs[i];
+      }
+    }
+  }
+
+  _range.getRaw(rawOut, rawOut, numSamples);
+}
+
+bool dc::ModuleParam::isSmoothing() const
+{
+  if (hasControlInput())
+  {
+    return _normInc != 0.0f || _valueMoving || _ctNormInc != 0.0f || _inputMoving;
+  }
+  return _normInc != 0.0f || _valueMoving;
 }
@@ -5,8 +5,13 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <string>
+#include "CurveTable.h"
 
 namespace dc
 {
@@ -15,6 +20,9 @@ class ParamRange final
 public:
   using GetNormFn = float (*)(float, float, float);
   using GetRawFn = float (*)(float, float, float);
+  using GetValueFn = float (*)(float);
+
+  static const size_t DEFAULT_TABLE_SIZE = 1024;
 
   ParamRange() = default;
 
@@ -28,7 +36,7 @@ public:
 
   ParamRange& operator=(const ParamRange& other);
 
-  // We don't need to move these. It's just 5 trivial copies.
+  // We don't need to move these. It's a few trivial copies, and copies share the tables.
   ParamRange(ParamRange&& other) = delete;
 
   ParamRange& operator=(ParamRange&& other) = delete;
@@ -37,8 +45,29 @@ public:
 
   float getRaw(float normalizedValue) const;
 
+  // getRaw() for a block of values, which can be converted in place
+  void getRaw(const float* normalizedValues, float* rawOut, size_t numValues) const;
+
   float constrainRaw(float rawValue) const;
 
+  // Opt in to lookup tables for the block conversions, so they interpolate from a table
+  // instead of calling the conversion function for every value.
+  // getValue converts raw values to whatever the module works with, like dB to linear gain, and gets a table too.
+  // Build the tables once, and share them by copying the range around.
+  // The error is measured when they're built, see getRawTable() and getValueTable().
+  void buildTables(size_t numPoints = DEFAULT_TABLE_SIZE, GetValueFn getValue = nullptr);
+
+  // converts a raw value with the function given to buildTables(), or returns it as is if there isn't one
+  float getValue(float rawValue) const;
+
+  // getValue() for a block of values, which can be converted in place
+  void getValue(const float* rawValues, float* valuesOut, size_t numValues) const;
+
+  // nullptr unless buildTables() was called
+  const CurveTable* getRawTable() const { return _rawTable.get(); }
+
+  const CurveTable* getValueTable() const { return _valueTable.get(); }
+
   float getMin() const { return _min; }
 
   float getMax() const { return _max; }
@@ -64,6 +93,9 @@ private:
   float _sliderSkew = 1.0f;
   GetNormFn _getNormalized = getNormalizedLinear;
   GetRawFn _getRaw = getRawLinear;
+  GetValueFn _getValue = nullptr;
+  std::shared_ptr<const CurveTable> _rawTable;
+  std::shared_ptr<const CurveTable> _valueTable;
 };
 
 class ModuleParam final
@@ -102,16 +134,75 @@ public:
 
   void setControlInput(float value);
 
+  // Sample-accurate control input.
+  // Normally the last control input value in a block is smoothed to over the whole of the next block.
+  // In sample-accurate mode, the input holds where it was until each value's own sample offset, in the same block,
+  // and steps to it there, so the result doesn't depend on where the blocks start and end.
+  bool isSampleAccurate() const { return _sampleAccurate; }
+
+  void setSampleAccurate(bool sampleAccurate);
+
   // for use by a Module's process() to get smoothed values with or without control combination
   void initSmoothing();
 
   void updateSmoothing(size_t numSamples);
 
+  // For use in process(), after updateSmoothing(), with the block's control input values in order.
+  // In sample-accurate mode, there's room for MAX_CONTROL_POINTS per block,
+  // and any more than that replace the last one, so the input still ends up at the last value.
+  void addControlInput(size_t sampleOffset, float value);
+
+  // for a block with no control input: it falls back to 0, or holds its value in sample-accurate mode
+  void noControlInput();
+
+  // Moves the value to rawValue at a sample offset in the module's next block, instead of smoothing to it over the
+  // whole block. The value holds where it was until sampleOffset, and steps to rawValue right there.
+  // Offsets past the end of the block land at the start of the next one.
+  // For the audio thread, before the module processes, like the graph does with Graph::postParamChange().
+  // Each block has room for MAX_CONTROL_POINTS of these, and any more than that replace the last one.
+  void scheduleRaw(size_t sampleOffset, float rawValue);
+
+  // For the audio thread, in place of a block the module isn't processed for, like when it's asleep or can't be heard.
+  // Anything scheduled for the block lands straight away, so it doesn't pile up until the module's processed again.
+  void skipBlock();
+
   float getSmoothedRaw(size_t sampleOffset) const;
 
+  // Renders getSmoothedRaw() for every sample in the block at once.
+  // The ramps are vectorized, and when the param isn't moving it's only converted once.
+  void getSmoothedRaw(float* rawOut, size_t numSamples) const;
+
+  // false if getSmoothedRaw() is the same for every sample in the block
+  bool isSmoothing() const;
+
   const ParamRange& getRange() const { return _range; }
 
+  static const size_t MAX_CONTROL_POINTS = 64;
+
 private:
+  struct ControlPoint
+  {
+    size_t sampleOffset;
+    float value;
+  };
+
+  // A value that holds start until the first point's offset, steps to each point at its offset, and then holds the
+  // last one. The points are in order, and within the block. One at the block size lands at the start of the next.
+  static float getSteppedValue(float start, const ControlPoint* points, size_t numPoints, size_t sampleOffset);
+
+  static void renderSteps(float* out, float start, const ControlPoint* points, size_t numPoints,
+                          size_t sampleOffset, size_t numSamples);
+
+  static void addPoint(ControlPoint* points, size_t& numPoints, size_t sampleOffset, float value);
+
+  // the control input at a sample offset, for the block set up by updateSmoothing()
+  float getSmoothedInput(size_t sampleOffset) const;
+
+  void renderSmoothedInput(float* inputOut, size_t sampleOffset, size_t numSamples) const;
+
+  // the normalized value at a sample offset, for the block set up by updateSmoothing()
+  float getSmoothedNormalized(size_t sampleOffset) const;
+
   std::string _id = "";
   std::string _displayName = "";
   ParamRange _range;
@@ -121,6 +212,7 @@ private:
   std::atomic<float> _value{0.0f};
   std::atomic<float> _controlTarget{0.0f};
   std::atomic<float> _controlInput{0.0f};
+  std::atomic<bool> _sampleAccurate{false};
 
   // for smoothing
   float _normStart = 0.0f;
@@ -132,5 +224,17 @@ private:
   float _inputStart = 0.0f;
   float _inputEnd = 0.0f;
   float _inputInc = 0.0f;
+  size_t _blockSize = 0;
+  // sample-accurate mode, as it was at the start of the block
+  bool _blockSampleAccurate = false;
+  bool _inputMoving = false;
+  std::array<ControlPoint, MAX_CONTROL_POINTS> _controlPoints;
+  size_t _numControlPoints = 0;
+  // from scheduleRaw(), normalized, waiting for the next block, and then the ones for this block
+  std::array<ControlPoint, MAX_CONTROL_POINTS> _scheduledPoints;
+  size_t _numScheduledPoints = 0;
+  std::array<ControlPoint, MAX_CONTROL_POINTS> _valuePoints;
+  size_t _numValuePoints = 0;
+  bool _valueMoving = false;
 };
 }
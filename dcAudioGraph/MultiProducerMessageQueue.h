@@ -0,0 +1,165 @@
+/*
+ * A bounded queue for passing messages from any number of threads to one other thread, without locks.
+ * It has the same interface as MessageQueue, so it can stand in wherever more than one thread needs to push,
+ * like the GUI, automation and scripting threads all sending to the audio thread.
+ * Each slot has a sequence number (Vyukov's bounded queue), so producers claim a slot with one compare-and-swap,
+ * and the consumer can tell if a slot is ready without waiting on anyone: popping is wait-free.
+ * Messages from one producer come out in the order it pushed them.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace dc
+{
+template<class MessageType>
+class MultiProducerMessageQueue final
+{
+public:
+  explicit MultiProducerMessageQueue(size_t maxSize) : _maxSize(maxSize)
+  {
+    size_t storageSize = 1;
+    while (storageSize < maxSize)
+    {
+      storageSize <<= 1;
+    }
+    _slots.reset(new Slot[storageSize]);
+    _mask = storageSize - 1;
+    for (size_t i = 0; i < storageSize; ++i)
+    {
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // no copy/move
+  MultiProducerMessageQueue(const MultiProducerMessageQueue&) = delete;
+
+  MultiProducerMessageQueue& operator=(const MultiProducerMessageQueue&) = delete;
+
+  MultiProducerMessageQueue(MultiProducerMessageQueue&&) = delete;
+
+  MultiProducerMessageQueue& operator=(MultiProducerMessageQueue&&) = delete;
+
+  // these can be called from any thread, and are out of date as soon as they return
+  bool empty() const { return numMessages() == 0; }
+
+  bool full() const { return numMessages() >= _maxSize; }
+
+  size_t numMessages() const
+  {
+    const size_t head = _head.load(std::memory_order_acquire);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    // a producer can be partway through a push, so the tail can look like it's behind
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t capacity() const { return _maxSize; }
+
+  // producer side, from any thread
+  bool push(const MessageType& msg)
+  {
+    size_t pos = _tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      // signed, since the consumer can have moved past a tail we loaded a while ago
+      const auto numQueued = static_cast<intptr_t>(pos - _head.load(std::memory_order_acquire));
+      if (numQueued >= static_cast<intptr_t>(_maxSize))
+      {
+        return false;
+      }
+
+      Slot& slot = _slots[pos & _mask];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0)
+      {
+        // the slot's free, so try to claim it
+        if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          slot.message = msg;
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        // the consumer hasn't got to it yet
+        return false;
+      }
+      else
+      {
+        // another producer got here first
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Pushes as many of the messages as fit, in order, and returns how many that was.
+  // Other producers' messages can end up in between them.
+  size_t pushBatch(const MessageType* msgs, size_t numMsgs)
+  {
+    size_t numPushed = 0;
+    while (numPushed < numMsgs && push(msgs[numPushed]))
+    {
+      ++numPushed;
+    }
+    return numPushed;
+  }
+
+  // consumer side, from one thread only
+  bool pop(MessageType& msg)
+  {
+    return popBatch(&msg, 1) == 1;
+  }
+
+  // pops up to maxMsgs messages, in order, and returns how many there were
+  size_t popBatch(MessageType* msgsOut, size_t maxMsgs)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    size_t numPopped = 0;
+    for (; numPopped < maxMsgs; ++numPopped)
+    {
+      // a slot that's been claimed but not written yet stops us here, until next time
+      Slot& slot = _slots[(head + numPopped) & _mask];
+      if (slot.sequence.load(std::memory_order_acquire) != head + numPopped + 1)
+      {
+        break;
+      }
+      msgsOut[numPopped] = slot.message;
+      slot.sequence.store(head + numPopped + _mask + 1, std::memory_order_release);
+    }
+    if (numPopped > 0)
+    {
+      _head.store(head + numPopped, std::memory_order_release);
+    }
+    return numPopped;
+  }
+
+private:
+  static const size_t CACHE_LINE_SIZE = 64;
+
+  struct Slot
+  {
+    std::atomic<size_t> sequence{0};
+    MessageType message;
+  };
+
+  // only read once set up
+  std::unique_ptr<Slot[]> _slots;
+  size_t _mask = 0;
+  const size_t _maxSize;
+  char _padding0[CACHE_LINE_SIZE];
+
+  // the consumer's
+  std::atomic<size_t> _head{0};
+  char _padding1[CACHE_LINE_SIZE];
+
+  // shared by the producers
+  std::atomic<size_t> _tail{0};
+  char _padding2[CACHE_LINE_SIZE];
+};
+}
@@ -0,0 +1,33 @@
+#include "Reclaimer.h"
+#include <algorithm>
+
+void dc::Reclaimer::retire(std::shared_ptr<void> object)
+{
+  collect();
+
+  if (nullptr == object)
+  {
+    return;
+  }
+
+  // If the audio thread is idle, it will see the replacement the next time it looks,
+  // so this can go right away. Otherwise, hang on until the current pass is done.
+  const uint64_t epoch = _epoch.load();
+  if (epoch % 2 == 1)
+  {
+    _retired.push_back({epoch, std::move(object)});
+  }
+}
+
+void dc::Reclaimer::collect()
+{
+  if (_retired.empty())
+  {
+    return;
+  }
+
+  const uint64_t epoch = _epoch.load();
+  _retired.erase(std::remove_if(_retired.begin(), _retired.end(),
+                                [epoch](const Retired& r) { return r.epoch != epoch; }),
+                 _retired.end());
+}
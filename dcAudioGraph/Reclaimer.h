@@ -0,0 +1,78 @@
+/*
+ * Frees things that the audio thread might still be using, once it's safe to.
+ * The audio thread brackets its use of shared data with enter() and exit(),
+ * and the edit thread hands over anything it has swapped out with retire().
+ * Retired things are held until the audio thread has either been idle or finished the pass
+ * it was in at the time, then freed on the edit thread by collect().
+ * Nothing ever waits on the audio thread.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dc
+{
+class Reclaimer final
+{
+public:
+  Reclaimer() = default;
+
+  // frees everything, so make sure the audio thread is done by now
+  ~Reclaimer() = default;
+
+  Reclaimer(const Reclaimer&) = delete;
+
+  Reclaimer& operator=(const Reclaimer&) = delete;
+
+  // audio thread
+  void enter() { _epoch.fetch_add(1); }
+
+  void exit() { _epoch.fetch_add(1); }
+
+  // calls enter() and exit() for a scope
+  class Scope final
+  {
+  public:
+    explicit Scope(Reclaimer& reclaimer) : _reclaimer(reclaimer) { _reclaimer.enter(); }
+
+    ~Scope() { _reclaimer.exit(); }
+
+    Scope(const Scope&) = delete;
+
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Reclaimer& _reclaimer;
+  };
+
+  // Edit thread
+  // Only retire things that the audio thread can no longer find, i.e. after swapping in their replacement.
+  void retire(std::shared_ptr<void> object);
+
+  template<class T>
+  void retire(std::unique_ptr<T> object)
+  {
+    retire(std::shared_ptr<void>(std::move(object)));
+  }
+
+  // free anything the audio thread is done with
+  void collect();
+
+  size_t getNumRetired() const { return _retired.size(); }
+
+private:
+  struct Retired
+  {
+    uint64_t epoch;
+    std::shared_ptr<void> object;
+  };
+
+  // odd while the audio thread is inside enter()/exit()
+  std::atomic<uint64_t> _epoch{0};
+  std::vector<Retired> _retired;
+};
+}
@@ -0,0 +1,201 @@
+#include "WorkerPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// how many times an idle worker spins before it goes to sleep until the next job
+const size_t WORKER_IDLE_SPINS = 4096;
+}
+
+dc::WorkerPool::WorkerPool(size_t numWorkers, const ThreadSetupFn& setupThread)
+{
+  _threads.reserve(numWorkers);
+  for (size_t i = 0; i < numWorkers; ++i)
+  {
+    _threads.emplace_back(&WorkerPool::workerLoop, this, i + 1, setupThread);
+  }
+
+  size_t spins = 0;
+  while (_numStarted.load() < numWorkers)
+  {
+    backoff(spins);
+  }
+}
+
+dc::WorkerPool::~WorkerPool()
+{
+  _running.store(false);
+  wakeWorkers();
+  for (auto& t : _threads)
+  {
+    t.join();
+  }
+}
+
+void dc::WorkerPool::run(Job& job)
+{
+  _job.store(&job);
+  _generation.fetch_add(1);
+  wakeWorkers();
+
+  job.work(0);
+
+  // take the job away, then wait for any workers that are still inside it
+  _job.store(nullptr);
+  size_t spins = 0;
+  while (_numActive.load() > 0)
+  {
+    backoff(spins);
+  }
+}
+
+void dc::WorkerPool::wakeWorkers()
+{
+  // A sleeper counts itself and then checks the generation, under the lock, and we change the generation and then
+  // check the count, so either it sees the change or we see it. Taking the lock means it's either still checking,
+  // and will see the change, or already waiting, and will get the notification.
+  if (_numSleeping.load() > 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+    }
+    _wakeUp.notify_all();
+  }
+}
+
+void dc::WorkerPool::pause()
+{
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+void dc::WorkerPool::backoff(size_t& spins)
+{
+  // spin for a bit, then give the thread we're waiting on a chance to run,
+  // in case it's sharing a core with us
+  if (++spins < 64)
+  {
+    pause();
+  }
+  else
+  {
+    spins = 0;
+    std::this_thread::yield();
+  }
+}
+
+void dc::WorkerPool::workerLoop(size_t workerIndex, const ThreadSetupFn& setupThread)
+{
+  if (setupThread)
+  {
+    setupThread(workerIndex);
+  }
+
+  size_t lastGeneration = _generation.load();
+  size_t idleSpins = 0;
+  _numStarted.fetch_add(1);
+
+  while (_running.load(std::memory_order_relaxed))
+  {
+    const size_t generation = _generation.load();
+    if (generation != lastGeneration)
+    {
+      lastGeneration = generation;
+      idleSpins = 0;
+
+      // register before looking at the job, so run() can't return while we're in it
+      _numActive.fetch_add(1);
+      if (auto* job = _job.load())
+      {
+        job->work(workerIndex);
+      }
+      _numActive.fetch_sub(1);
+    }
+    else if (++idleSpins < WORKER_IDLE_SPINS)
+    {
+      pause();
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(_sleepMutex);
+      _numSleeping.fetch_add(1);
+      _wakeUp.wait(lock, [&]()
+      {
+        return _generation.load() != lastGeneration || !_running.load();
+      });
+      _numSleeping.fetch_sub(1);
+      idleSpins = 0;
+    }
+  }
+}
+
+dc::WorkStealingQueue::WorkStealingQueue(size_t capacity) :
+    _tasks(new std::atomic<size_t>[capacity]),
+    _capacity(static_cast<int64_t>(capacity))
+{
+}
+
+void dc::WorkStealingQueue::reset()
+{
+  _top.store(0, std::memory_order_relaxed);
+  _bottom.store(0, std::memory_order_relaxed);
+}
+
+bool dc::WorkStealingQueue::push(size_t task)
+{
+  const int64_t b = _bottom.load(std::memory_order_relaxed);
+  if (b >= _capacity)
+  {
+    return false;
+  }
+  _tasks[b].store(task, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _bottom.store(b + 1, std::memory_order_relaxed);
+  return true;
+}
+
+bool dc::WorkStealingQueue::pop(size_t& task)
+{
+  const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+  _bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = _top.load(std::memory_order_relaxed);
+
+  if (t > b)
+  {
+    // empty
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  task = _tasks[b].load(std::memory_order_relaxed);
+  if (t == b)
+  {
+    // last task, so race any thieves for it
+    const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+bool dc::WorkStealingQueue::steal(size_t& task)
+{
+  int64_t t = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = _bottom.load(std::memory_order_acquire);
+
+  if (t >= b)
+  {
+    return false;
+  }
+
+  task = _tasks[t].load(std::memory_order_relaxed);
+  return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
@@ -0,0 +1,115 @@
+/*
+ * A small pool of worker threads for splitting a block of work across cores.
+ * The thread calling run() always takes part in the job as worker 0,
+ * so a job can finish even if the workers are slow to wake up.
+ * Workers run at the default priority. If your audio thread runs at a real-time priority,
+ * you'll probably want to raise the workers to match: pass a setup function when the pool is made,
+ * and it's called on each worker thread before it does anything else.
+ * Idle workers spin for a while, then go to sleep until the next job.
+ * Waking them costs the first job after a quiet spell an OS wakeup, and run() a brief uncontended lock.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dc
+{
+class WorkerPool final
+{
+public:
+  class Job
+  {
+  public:
+    virtual ~Job() = default;
+
+    // called once from every participating thread
+    // workerIndex 0 is the thread that called run(), workers are 1...getNumWorkers()
+    virtual void work(size_t workerIndex) = 0;
+  };
+
+  // called on a worker thread when it starts, with its worker index, to set its priority or affinity or whatever
+  using ThreadSetupFn = std::function<void(size_t workerIndex)>;
+
+  // returns once every worker has been set up
+  explicit WorkerPool(size_t numWorkers, const ThreadSetupFn& setupThread = nullptr);
+
+  ~WorkerPool();
+
+  // no copy/move
+  WorkerPool(const WorkerPool&) = delete;
+
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  WorkerPool(WorkerPool&&) = delete;
+
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  size_t getNumWorkers() const { return _threads.size(); }
+
+  // run the job on the calling thread and on all workers
+  // returns once the calling thread has finished its share and every worker has left the job
+  void run(Job& job);
+
+  // a cheap hint to the CPU that we're in a spin loop
+  static void pause();
+
+  // pause, and yield every so often
+  static void backoff(size_t& spins);
+
+private:
+  void workerLoop(size_t workerIndex, const ThreadSetupFn& setupThread);
+
+  // wakes any workers that have gone to sleep, after the generation has changed
+  void wakeWorkers();
+
+  std::vector<std::thread> _threads;
+  std::atomic<Job*> _job{nullptr};
+  std::atomic<size_t> _generation{0};
+  std::atomic<size_t> _numActive{0};
+  std::atomic<bool> _running{true};
+  std::atomic<size_t> _numStarted{0};
+
+  // for idle workers
+  std::mutex _sleepMutex;
+  std::condition_variable _wakeUp;
+  std::atomic<size_t> _numSleeping{0};
+};
+
+// A fixed-capacity Chase-Lev deque of task indices.
+// The owning thread pushes and pops at the bottom, other threads steal from the top.
+// It never wraps around, so it has to be reset() between jobs, while no other threads are using it.
+class WorkStealingQueue final
+{
+public:
+  explicit WorkStealingQueue(size_t capacity);
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+
+  WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+  void reset();
+
+  // owner only
+  bool push(size_t task);
+
+  // owner only
+  bool pop(size_t& task);
+
+  // any thread
+  bool steal(size_t& task);
+
+private:
+  std::unique_ptr<std::atomic<size_t>[]> _tasks;
+  const int64_t _capacity;
+  std::atomic<int64_t> _top{0};
+  std::atomic<int64_t> _bottom{0};
+};
+}
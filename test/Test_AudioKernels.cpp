@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Test_Common.h"
+#include "../dcAudioGraph/AudioKernels.h"
+
+using namespace dc;
+
+namespace
+{
+// every set of kernels this machine can run, besides the scalar reference
+std::vector<const AudioKernels*> getKernelsToTest()
+{
+  std::vector<const AudioKernels*> kernels;
+  for (auto isa : {AudioKernels::Isa::Sse2, AudioKernels::Isa::Avx2, AudioKernels::Isa::Neon})
+  {
+    if (auto* k = getAudioKernels(isa))
+    {
+      kernels.push_back(k);
+    }
+  }
+  return kernels;
+}
+
+// Lengths around the vector widths, to catch mistakes in the tails.
+// The data starts one float in, so the loads and stores aren't aligned either.
+const size_t maxLength = 67;
+
+std::vector<float> makeSignal(std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> signal(maxLength + 1);
+  for (auto& s : signal)
+  {
+    s = dist(rng);
+  }
+  return signal;
+}
+
+void expectSame(const std::vector<float>& expected, const std::vector<float>& actual, const char* name,
+                size_t length)
+{
+  for (size_t i = 0; i < expected.size(); ++i)
+  {
+    ASSERT_TRUE(samplesEqual(expected[i], actual[i])) << name << ", length " << length << ", sample " << i;
+  }
+}
+}
+
+TEST(AudioKernels, Selection)
+{
+  const auto& best = getAudioKernels();
+  EXPECT_EQ(getAudioKernels(best.isa), &best);
+  EXPECT_NE(getAudioKernels(AudioKernels::Isa::Scalar), nullptr);
+}
+
+TEST(AudioKernels, MatchScalar)
+{
+  const auto& ref = *getAudioKernels(AudioKernels::Isa::Scalar);
+  std::mt19937 rng(42);
+  const auto src = makeSignal(rng);
+  const auto dstStart = makeSignal(rng);
+
+  for (auto* k : getKernelsToTest())
+  {
+    for (size_t length = 0; length <= maxLength; ++length)
+    {
+      auto expected = dstStart;
+      auto actual = dstStart;
+
+      ref.fill(expected.data() + 1, 0.25f, length);
+      k->fill(actual.data() + 1, 0.25f, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.add(expected.data() + 1, src.data() + 1, length);
+      k->add(actual.data() + 1, src.data() + 1, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.addWithGain(expected.data() + 1, src.data() + 1, 0.7f, length);
+      k->addWithGain(actual.data() + 1, src.data() + 1, 0.7f, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.copyWithGain(expected.data() + 1, src.data() + 1, -1.3f, length);
+      k->copyWithGain(actual.data() + 1, src.data() + 1, -1.3f, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.applyGain(expected.data() + 1, 0.5f, length);
+      k->applyGain(actual.data() + 1, 0.5f, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.addWithGainRamp(expected.data() + 1, src.data() + 1, 1.0f, -0.01f, length);
+      k->addWithGainRamp(actual.data() + 1, src.data() + 1, 1.0f, -0.01f, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.multiply(expected.data() + 1, src.data() + 1, length);
+      k->multiply(actual.data() + 1, src.data() + 1, length);
+      expectSame(expected, actual, k->name, length);
+
+      ref.ramp(expected.data() + 1, 0.3f, 0.0123f, length);
+      k->ramp(actual.data() + 1, 0.3f, 0.0123f, length);
+      expectSame(expected, actual, k->name, length);
+
+      // a table with a bend in it, looked up from a little past both ends
+      const float table[] = {0.0f, 1.0f, 0.5f, -0.25f, 2.0f, 2.0f};
+      ref.lookup(expected.data() + 1, src.data() + 1, table, 5, 2.4f, 2.0f, length);
+      k->lookup(actual.data() + 1, src.data() + 1, table, 5, 2.4f, 2.0f, length);
+      expectSame(expected, actual, k->name, length);
+
+      EXPECT_TRUE(samplesEqual(ref.sumOfSquares(src.data() + 1, length), k->sumOfSquares(src.data() + 1, length)))
+        << k->name << ", length " << length;
+      EXPECT_EQ(ref.peak(src.data() + 1, length), k->peak(src.data() + 1, length))
+        << k->name << ", length " << length;
+    }
+  }
+}
+
+TEST(AudioKernels, TransposesMatchScalar)
+{
+  const auto& ref = *getAudioKernels(AudioKernels::Isa::Scalar);
+  std::mt19937 rng(43);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+  // the specialized channel counts, and some awkward ones around them
+  for (size_t numChannels : {1, 2, 3, 4, 5, 8, 11, 16, 17})
+  {
+    // whole frames, and just the first few channels of bigger frames
+    for (size_t frameSize : {numChannels, numChannels + 3})
+    {
+      const size_t stride = maxLength + 5;
+      std::vector<float> channels(stride * numChannels);
+      std::vector<float> frames(frameSize * maxLength);
+      for (auto& s : channels)
+      {
+        s = dist(rng);
+      }
+      for (auto& s : frames)
+      {
+        s = dist(rng);
+      }
+
+      for (auto* k : getKernelsToTest())
+      {
+        for (size_t length : {size_t(0), size_t(3), size_t(4), size_t(13), maxLength})
+        {
+          auto expected = frames;
+          auto actual = frames;
+          ref.interleave(expected.data(), frameSize, channels.data(), stride, numChannels, length);
+          k->interleave(actual.data(), frameSize, channels.data(), stride, numChannels, length);
+          ASSERT_EQ(expected, actual) << k->name << " interleave, " << numChannels << " of " << frameSize;
+
+          expected = channels;
+          actual = channels;
+          ref.deinterleave(expected.data(), stride, frames.data(), frameSize, numChannels, length);
+          k->deinterleave(actual.data(), stride, frames.data(), frameSize, numChannels, length);
+          ASSERT_EQ(expected, actual) << k->name << " deinterleave, " << numChannels << " of " << frameSize;
+        }
+      }
+    }
+  }
+}
+
+TEST(AudioKernels, FixedPoint)
+{
+  const auto& ref = *getAudioKernels(AudioKernels::Isa::Scalar);
+
+  // known values, including rounding and saturation
+  const std::vector<float> floats = {0.0f, 0.5f, -0.5f, 1.0f, -1.0f, 1.5f, -1.5f, 0.25f / 32768.0f,
+                                     0.75f / 32768.0f, -0.75f / 32768.0f};
+  std::vector<int16_t> int16s(floats.size());
+  ref.floatToInt16(int16s.data(), floats.data(), floats.size());
+  EXPECT_EQ(int16s, std::vector<int16_t>({0, 16384, -16384, 32767, -32768, 32767, -32768, 0, 1, -1}));
+
+  std::vector<uint8_t> int24s(floats.size() * 3);
+  ref.floatToInt24(int24s.data(), floats.data(), floats.size());
+  EXPECT_EQ(int24s[3], 0x00);
+  EXPECT_EQ(int24s[4], 0x00);
+  EXPECT_EQ(int24s[5], 0x40);
+  EXPECT_EQ(int24s[12], 0x00);
+  EXPECT_EQ(int24s[13], 0x00);
+  EXPECT_EQ(int24s[14], 0x80);
+  std::vector<float> back(floats.size());
+  ref.int24ToFloat(back.data(), int24s.data(), floats.size());
+  EXPECT_EQ(back[2], -0.5f);
+  EXPECT_EQ(back[4], -1.0f);
+
+  std::vector<int32_t> int32s(floats.size());
+  ref.floatToInt32(int32s.data(), floats.data(), floats.size());
+  EXPECT_EQ(int32s[1], 1073741824);
+  EXPECT_EQ(int32s[4], INT32_MIN);
+  EXPECT_GT(int32s[5], 2147483000);
+
+  // and every other instruction set gets exactly the same answers
+  std::mt19937 rng(44);
+  std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+  std::vector<float> src(maxLength);
+  for (auto& s : src)
+  {
+    s = dist(rng);
+  }
+  std::vector<int16_t> refInt16(maxLength);
+  std::vector<uint8_t> refInt24(maxLength * 3);
+  std::vector<int32_t> refInt32(maxLength);
+  ref.floatToInt16(refInt16.data(), src.data(), maxLength);
+  ref.floatToInt24(refInt24.data(), src.data(), maxLength);
+  ref.floatToInt32(refInt32.data(), src.data(), maxLength);
+  std::vector<float> refFloats(maxLength);
+
+  for (auto* k : getKernelsToTest())
+  {
+    for (size_t length : {size_t(0), size_t(5), size_t(8), maxLength})
+    {
+      std::vector<int16_t> int16Out(maxLength, 0);
+      std::vector<uint8_t> int24Out(maxLength * 3, 0);
+      std::vector<int32_t> int32Out(maxLength, 0);
+      k->floatToInt16(int16Out.data(), src.data(), length);
+      k->floatToInt24(int24Out.data(), src.data(), length);
+      k->floatToInt32(int32Out.data(), src.data(), length);
+      EXPECT_TRUE(std::equal(int16Out.begin(), int16Out.begin() + length, refInt16.begin())) << k->name;
+      EXPECT_TRUE(std::equal(int24Out.begin(), int24Out.begin() + length * 3, refInt24.begin())) << k->name;
+      EXPECT_TRUE(std::equal(int32Out.begin(), int32Out.begin() + length, refInt32.begin())) << k->name;
+
+      std::vector<float> floatOut(maxLength, 0.0f);
+      ref.int16ToFloat(refFloats.data(), refInt16.data(), length);
+      k->int16ToFloat(floatOut.data(), refInt16.data(), length);
+      EXPECT_TRUE(std::equal(floatOut.begin(), floatOut.begin() + length, refFloats.begin())) << k->name;
+      ref.int24ToFloat(refFloats.data(), refInt24.data(), length);
+      k->int24ToFloat(floatOut.data(), refInt24.data(), length);
+      EXPECT_TRUE(std::equal(floatOut.begin(), floatOut.begin() + length, refFloats.begin())) << k->name;
+      ref.int32ToFloat(refFloats.data(), refInt32.data(), length);
+      k->int32ToFloat(floatOut.data(), refInt32.data(), length);
+      EXPECT_TRUE(std::equal(floatOut.begin(), floatOut.begin() + length, refFloats.begin())) << k->name;
+    }
+  }
+}
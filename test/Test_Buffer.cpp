@@ -1,3 +1,6 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
 #include "gtest/gtest.h"
 #include "Test_Common.h"
 
@@ -156,6 +159,42 @@ TEST(AudioBuffer, AddFunctional)
   EXPECT_TRUE(buffersEqual(b1, bE));
 }
 
+TEST(AudioBuffer, GainFunctional)
+{
+  const size_t numSamples = 100;
+
+  AudioBuffer from(numSamples, 1);
+  from.fill(0.5f);
+  AudioBuffer to(numSamples, 2);
+  to.fill(0.25f);
+
+  to.addFromWithGain(from, 0, 0, 0.5f);
+  to.copyFromWithGain(from, 0, 1, 3.0f);
+  for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+  {
+    EXPECT_TRUE(samplesEqual(to.getChannelPointer(0)[sIdx], 0.5f));
+    EXPECT_TRUE(samplesEqual(to.getChannelPointer(1)[sIdx], 1.5f));
+  }
+
+  // the ramp ends one step short of endGain, so the next block can pick up from there
+  to.zero();
+  to.addFromWithRamp(from, 0, 0, 0.0f, 2.0f);
+  EXPECT_FALSE(to.isSilent(0));
+  EXPECT_TRUE(samplesEqual(to.getChannelPointer(0)[0], 0.0f));
+  EXPECT_TRUE(samplesEqual(to.getChannelPointer(0)[numSamples / 2], 0.5f));
+  EXPECT_TRUE(samplesEqual(to.getChannelPointer(0)[numSamples - 1], 0.5f * 2.0f * (numSamples - 1) / numSamples));
+
+  // no gain, or a silent source, leaves silence
+  to.copyFromWithGain(from, 0, 0, 0.0f);
+  EXPECT_TRUE(to.isSilent(0));
+  to.addFromWithGain(from, 0, 0, 0.0f);
+  EXPECT_TRUE(to.isSilent(0));
+  from.zero();
+  to.addFromWithRamp(from, 0, 0, 1.0f, 1.0f);
+  to.copyFromWithGain(from, 0, 1, 1.0f);
+  EXPECT_TRUE(to.isSilent());
+}
+
 TEST(AudioBuffer, ApplyGainFunctional)
 {
   const size_t numSamples = 1000;
@@ -257,3 +296,228 @@ TEST(AudioBuffer, ToInterleavedFunctional)
     }
   }
 }
+
+TEST(AudioBuffer, FixedPointInterleaved)
+{
+  const size_t numSamples = 100;
+  const size_t numChannels = 6;
+
+  AudioBuffer b(numSamples, numChannels);
+  for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+  {
+    auto* cPtr = b.getChannelPointer(cIdx);
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      cPtr[sIdx] = std::sin(0.1f * sIdx + cIdx);
+    }
+  }
+
+  // round trips are good to within the format's resolution
+  const std::vector<std::pair<AudioBuffer::SampleFormat, size_t>> formats = {{AudioBuffer::SampleFormat::Int16, 2},
+                                                                             {AudioBuffer::SampleFormat::Int24, 3},
+                                                                             {AudioBuffer::SampleFormat::Int32, 4}};
+  for (auto& f : formats)
+  {
+    std::vector<uint8_t> interleaved(numSamples * numChannels * f.second);
+    b.toInterleaved(interleaved.data(), f.first, numSamples, numChannels);
+    AudioBuffer roundTrip;
+    roundTrip.fromInterleaved(interleaved.data(), f.first, numSamples, numChannels, true);
+    EXPECT_TRUE(buffersEqual(b, roundTrip));
+  }
+
+  // channels and samples the buffer doesn't have come out as zeros
+  std::vector<int16_t> wide((numSamples + 10) * (numChannels + 2), 1);
+  b.toInterleaved(wide.data(), AudioBuffer::SampleFormat::Int16, numSamples + 10, numChannels + 2);
+  EXPECT_EQ(wide[0], 0);
+  EXPECT_EQ(wide[1], static_cast<int16_t>(std::lrint(std::sin(1.0f) * 32768.0f)));
+  EXPECT_EQ(wide[numChannels], 0);
+  EXPECT_EQ(wide[numChannels + 1], 0);
+  EXPECT_EQ(wide.back(), 0);
+
+  // and only the channels that fit are read in
+  AudioBuffer narrow(numSamples, 2);
+  narrow.zero();
+  narrow.fromInterleaved(wide.data(), AudioBuffer::SampleFormat::Int16, numSamples, numChannels + 2, false);
+  EXPECT_TRUE(samplesEqual(narrow.getChannelPointer(1)[0], std::sin(1.0f)));
+  EXPECT_TRUE(samplesEqual(narrow.getChannelPointer(1)[5], std::sin(1.5f)));
+}
+
+TEST(AudioBuffer, HugeFrames)
+{
+  // more channels than fit in the conversion block
+  const size_t numSamples = 3;
+  const size_t numChannels = 1500;
+
+  AudioBuffer b(numSamples, numChannels);
+  for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+  {
+    b.fill(cIdx, (cIdx % 100) / 100.0f);
+  }
+
+  std::vector<int32_t> interleaved(numSamples * numChannels);
+  b.toInterleaved(interleaved.data(), AudioBuffer::SampleFormat::Int32, numSamples, numChannels);
+  AudioBuffer roundTrip;
+  roundTrip.fromInterleaved(interleaved.data(), AudioBuffer::SampleFormat::Int32, numSamples, numChannels, true);
+  EXPECT_TRUE(buffersEqual(b, roundTrip));
+}
+
+TEST(AudioBuffer, Layout)
+{
+  // an awkward size, so the channels need padding
+  const size_t numSamples = 100;
+  const size_t numChannels = 3;
+
+  AudioBuffer b(numSamples, numChannels);
+  EXPECT_EQ(b.getChannelStride(), AudioBuffer::getPaddedStride(numSamples));
+  EXPECT_GE(b.getChannelStride(), numSamples);
+  for (size_t cIdx = 0; cIdx < numChannels; ++cIdx)
+  {
+    const auto* cPtr = b.getChannelPointer(cIdx);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(cPtr) % AudioBuffer::ALIGNMENT, 0);
+    EXPECT_EQ(cPtr, b.getChannelPointer(0) + cIdx * b.getChannelStride());
+  }
+
+  // channels don't step on each other
+  b.fill(1.0f);
+  b.zero(1);
+  EXPECT_EQ(b.getPeak(0), 1.0f);
+  EXPECT_EQ(b.getPeak(1), 0.0f);
+  EXPECT_EQ(b.getPeak(2), 1.0f);
+  AudioBuffer copy(b);
+  EXPECT_TRUE(buffersEqual(b, copy));
+
+  // shrinking keeps the layout consistent
+  b.resize(numSamples / 2, numChannels);
+  EXPECT_EQ(b.getChannelStride(), AudioBuffer::getPaddedStride(numSamples / 2));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b.getChannelPointer(1)) % AudioBuffer::ALIGNMENT, 0);
+}
+
+TEST(AudioBuffer, Move)
+{
+  const size_t numSamples = 64;
+  const size_t numChannels = 2;
+
+  // read-only pointers, so the silence flags are left alone
+  auto dataOf = [](const AudioBuffer& buffer) { return buffer.getChannelPointer(0); };
+
+  AudioBuffer b(numSamples, numChannels);
+  b.fill(0.5f);
+  b.zero(1);
+  const float* data = dataOf(b);
+
+  // moving takes the memory and the flags along, without copying
+  AudioBuffer moved(std::move(b));
+  EXPECT_EQ(dataOf(moved), data);
+  EXPECT_EQ(moved.getNumSamples(), numSamples);
+  EXPECT_FALSE(moved.isSilent(0));
+  EXPECT_TRUE(moved.isSilent(1));
+  EXPECT_EQ(b.getNumChannels(), 0);
+  EXPECT_EQ(dataOf(b), nullptr);
+
+  AudioBuffer assigned(8, 1);
+  assigned = std::move(moved);
+  EXPECT_EQ(dataOf(assigned), data);
+  EXPECT_TRUE(assigned.isSilent(1));
+
+  // what's left behind can still be used
+  moved.resize(numSamples, 1);
+  moved.fill(0.25f);
+  EXPECT_EQ(moved.getPeak(0), 0.25f);
+
+  // and containers move them instead of copying
+  std::vector<AudioBuffer> buffers;
+  buffers.push_back(std::move(assigned));
+  for (int i = 0; i < 10; ++i)
+  {
+    buffers.emplace_back(numSamples, numChannels);
+  }
+  EXPECT_EQ(dataOf(buffers[0]), data);
+}
+
+TEST(AudioBuffer, ExternalData)
+{
+  const size_t numSamples = 64;
+  const size_t numChannels = 2;
+
+  std::vector<float> memory(numSamples * numChannels * 2, 1.0f);
+  AudioBuffer b(numSamples, numChannels);
+  b.setExternalData(memory.data() + numSamples, nullptr, numSamples, numChannels, numSamples);
+  EXPECT_EQ(b.getChannelPointer(0), memory.data() + numSamples);
+
+  b.zero();
+  for (size_t i = 0; i < memory.size(); ++i)
+  {
+    const bool inBuffer = i >= numSamples && i < numSamples * (numChannels + 1);
+    EXPECT_EQ(memory[i], inBuffer ? 0.0f : 1.0f);
+  }
+
+  // growing past the end of the external memory gives the buffer its own again
+  b.resize(numSamples, numChannels * 4);
+  b.fill(2.0f);
+  EXPECT_EQ(memory[numSamples], 0.0f);
+}
+
+TEST(AudioBuffer, SilenceFlags)
+{
+  const size_t numSamples = 32;
+  const size_t numChannels = 3;
+
+  AudioBuffer b(numSamples, numChannels);
+  EXPECT_FALSE(b.isSilent(0));
+  b.zero();
+  EXPECT_TRUE(b.isSilent());
+
+  // writing through a channel pointer only touches that channel
+  b.getChannelPointer(1)[0] = 1.0f;
+  EXPECT_TRUE(b.isSilent(0));
+  EXPECT_FALSE(b.isSilent(1));
+  EXPECT_TRUE(b.isSilent(2));
+  EXPECT_FALSE(b.isSilent());
+
+  // writing across the whole buffer touches all of them
+  b.zero();
+  b.getWritableData()[2 * b.getChannelStride()] = 1.0f;
+  EXPECT_FALSE(b.isSilent(0));
+  EXPECT_FALSE(b.isSilent(2));
+  b.zero();
+
+  // reading leaves them alone
+  const AudioBuffer& constB = b;
+  EXPECT_NE(constB.getChannelPointer(0), nullptr);
+  EXPECT_TRUE(b.isSilent(0));
+
+  b.zero(2);
+  b.fill(1, 0.0f);
+  EXPECT_TRUE(b.isSilent());
+  b.fill(0, 0.5f);
+  EXPECT_FALSE(b.isSilent(0));
+  EXPECT_EQ(b.getPeak(1), 0.0f);
+
+  // copying and adding carry the flags along
+  AudioBuffer other(numSamples, numChannels);
+  other.fill(1.0f);
+  other.copyFrom(b, false);
+  EXPECT_FALSE(other.isSilent(0));
+  EXPECT_TRUE(other.isSilent(1));
+  EXPECT_TRUE(other.isSilent(2));
+  const AudioBuffer& constOther = other;
+  EXPECT_EQ(constOther.getChannelPointer(1)[0], 0.0f);
+
+  other.addFrom(b, 2, 1);
+  EXPECT_TRUE(other.isSilent(1));
+  other.addFrom(b, 0, 1);
+  EXPECT_FALSE(other.isSilent(1));
+  EXPECT_EQ(constOther.getChannelPointer(1)[0], 0.5f);
+
+  // external flags are shared with whoever owns them
+  std::vector<float> memory(numSamples * 2);
+  bool flags[2] = {false, true};
+  AudioBuffer view;
+  view.setExternalData(memory.data(), flags, numSamples, 2, numSamples);
+  EXPECT_FALSE(view.isSilent(0));
+  EXPECT_TRUE(view.isSilent(1));
+  view.zero(0);
+  EXPECT_TRUE(flags[0]);
+  view.getChannelPointer(1);
+  EXPECT_FALSE(flags[1]);
+}
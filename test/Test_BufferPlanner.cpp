@@ -0,0 +1,68 @@
+#include <random>
+#include "gtest/gtest.h"
+#include "../dcAudioGraph/BufferPlanner.h"
+
+using namespace dc;
+
+TEST(BufferPlanner, Chain)
+{
+  // each buffer is read by the next one, and then it's done with
+  BufferPlanner p;
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    p.addBuffer(64, i, i + 1);
+  }
+  p.plan();
+
+  EXPECT_EQ(p.getUnpooledSize(), 64 * 1000);
+  EXPECT_EQ(p.getPooledSize(), 64 * 2);
+  for (size_t i = 1; i < p.getNumBuffers(); ++i)
+  {
+    EXPECT_NE(p.getOffset(i), p.getOffset(i - 1));
+  }
+}
+
+TEST(BufferPlanner, NoOverlaps)
+{
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<size_t> sizeDist(0, 512);
+  std::uniform_int_distribution<size_t> spanDist(0, 20);
+
+  struct B
+  {
+    size_t size;
+    size_t first;
+    size_t last;
+  };
+  std::vector<B> buffers;
+  const size_t numBuffers = 500;
+  for (size_t i = 0; i < numBuffers; ++i)
+  {
+    const size_t size = sizeDist(rng);
+    buffers.push_back({size, i, i + spanDist(rng)});
+  }
+
+  BufferPlanner p;
+  for (auto& b : buffers)
+  {
+    p.addBuffer(b.size, b.first, b.last);
+  }
+  p.plan();
+  EXPECT_LE(p.getPooledSize(), p.getUnpooledSize());
+
+  // check every pair of buffers that are needed at the same time
+  for (size_t i = 0; i < numBuffers; ++i)
+  {
+    EXPECT_LE(p.getOffset(i) + buffers[i].size, p.getPooledSize());
+    for (size_t j = i + 1; j < numBuffers && buffers[j].first <= buffers[i].last; ++j)
+    {
+      if (buffers[i].size == 0 || buffers[j].size == 0)
+      {
+        continue;
+      }
+      const bool apart = p.getOffset(i) + buffers[i].size <= p.getOffset(j)
+                         || p.getOffset(j) + buffers[j].size <= p.getOffset(i);
+      EXPECT_TRUE(apart) << "buffers " << i << " and " << j << " overlap";
+    }
+  }
+}
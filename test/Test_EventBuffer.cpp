@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../dcAudioGraph/EventBuffer.h"
+
+using namespace dc;
+
+namespace
+{
+// a note, tagged with an id in the note number so the order can be checked
+EventMessage makeMessage(uint32_t sampleOffset, int id, EventMessage::Type type = EventMessage::Type::Note)
+{
+  EventMessage msg(type, sampleOffset);
+  msg.noteParam.noteNumber = id;
+  return msg;
+}
+
+std::vector<int> getIds(EventBuffer::Channel& channel)
+{
+  std::vector<int> ids;
+  auto it = channel.getIterator();
+  EventMessage msg;
+  while (it.next(msg))
+  {
+    ids.push_back(msg.noteParam.noteNumber);
+  }
+  return ids;
+}
+}
+
+TEST(EventBuffer, InsertIsStable)
+{
+  EventBuffer::Channel channel;
+  channel.insert(makeMessage(5, 0));
+  channel.insert(makeMessage(2, 1));
+  channel.insert(makeMessage(5, 2));
+  channel.insert(makeMessage(2, 3));
+  channel.insert(makeMessage(0, 4));
+  channel.insert(makeMessage(9, 5));
+  EXPECT_EQ(getIds(channel), std::vector<int>({4, 1, 3, 0, 2, 5}));
+}
+
+TEST(EventBuffer, MergeIsStable)
+{
+  EventBuffer::Channel a;
+  EventBuffer::Channel b;
+  a.insert(makeMessage(1, 0));
+  a.insert(makeMessage(3, 1));
+  a.insert(makeMessage(3, 2));
+  b.insert(makeMessage(0, 3));
+  b.insert(makeMessage(3, 4));
+  b.insert(makeMessage(7, 5, EventMessage::Type::Float));
+  b.insert(makeMessage(8, 6));
+
+  EventBuffer::Channel all = a;
+  all.merge(b);
+  EXPECT_EQ(getIds(all), std::vector<int>({3, 0, 1, 2, 4, 5, 6}));
+
+  // only the notes
+  EventBuffer::Channel notes = a;
+  notes.merge(b, EventMessage::Type::Note);
+  EXPECT_EQ(getIds(notes), std::vector<int>({3, 0, 1, 2, 4, 6}));
+
+  // into an empty channel, and from one
+  EventBuffer::Channel empty;
+  empty.merge(a);
+  EXPECT_EQ(getIds(empty), getIds(a));
+  a.merge(EventBuffer::Channel());
+  EXPECT_EQ(a.size(), 3);
+}
+
+TEST(EventBuffer, RandomMatchesStableSort)
+{
+  std::mt19937 rng(45);
+  std::uniform_int_distribution<size_t> offsetDist(0, 63);
+
+  for (size_t numMessages : {1, 10, 100, 1000})
+  {
+    // inserted one at a time, and merged in sorted runs, against a stable sort of everything in the order it came
+    std::vector<EventMessage> expected;
+    EventBuffer::Channel inserted;
+    EventBuffer::Channel merged;
+    EventBuffer::Channel run;
+    for (size_t i = 0; i < numMessages; ++i)
+    {
+      const auto msg = makeMessage(offsetDist(rng), static_cast<int>(i));
+      expected.push_back(msg);
+      inserted.insert(msg);
+      run.insert(msg);
+      if (run.size() == 7 || i + 1 == numMessages)
+      {
+        merged.merge(run);
+        run.clear();
+      }
+    }
+
+    std::stable_sort(expected.begin(), expected.end(), [](const EventMessage& a, const EventMessage& b)
+    {
+      return a.sampleOffset < b.sampleOffset;
+    });
+    std::vector<int> expectedIds;
+    for (auto& msg : expected)
+    {
+      expectedIds.push_back(msg.noteParam.noteNumber);
+    }
+
+    EXPECT_EQ(getIds(inserted), expectedIds);
+    EXPECT_EQ(getIds(merged), expectedIds);
+  }
+}
+
+TEST(EventBuffer, ExternalStorage)
+{
+  EventMessage storage[4];
+  std::atomic<size_t> numOverflows{0};
+  EventBuffer::Channel channel;
+  channel.setExternalStorage(storage, 4, &numOverflows);
+  EXPECT_EQ(channel.capacity(), 4);
+
+  for (int i = 0; i < 4; ++i)
+  {
+    channel.insert(makeMessage(static_cast<size_t>(3 - i), i));
+  }
+  EXPECT_EQ(numOverflows, 0);
+  EXPECT_EQ(storage[0].noteParam.noteNumber, 3);
+
+  // a fifth doesn't fit, and the channel doesn't make room, so the latest message goes
+  channel.insert(makeMessage(1, 4));
+  EXPECT_EQ(numOverflows, 1);
+  EXPECT_EQ(channel.capacity(), 4);
+  EXPECT_EQ(getIds(channel), std::vector<int>({3, 2, 4, 1}));
+
+  // even if it's the one being added
+  channel.insert(makeMessage(5, 5));
+  EXPECT_EQ(numOverflows, 2);
+  EXPECT_EQ(getIds(channel), std::vector<int>({3, 2, 4, 1}));
+
+  // merging keeps as many of the earliest as fit
+  EventBuffer::Channel other;
+  other.insert(makeMessage(0, 6));
+  other.insert(makeMessage(1, 7));
+  other.insert(makeMessage(4, 8));
+  channel.merge(other);
+  EXPECT_EQ(numOverflows, 5);
+  EXPECT_EQ(getIds(channel), std::vector<int>({3, 6, 2, 4}));
+  EXPECT_EQ(storage[0].noteParam.noteNumber, 3);
+
+  // copies have their own storage, and grow instead of dropping
+  EventBuffer::Channel copy = channel;
+  for (int i = 0; i < 100; ++i)
+  {
+    copy.insert(makeMessage(10, i));
+  }
+  EXPECT_EQ(numOverflows, 5);
+  EXPECT_EQ(copy.size(), 104);
+}
+
+TEST(EventBuffer, ReadInPlace)
+{
+  EventBuffer::Channel channel;
+  EXPECT_EQ(channel.begin(), channel.end());
+
+  for (int i = 0; i < 5; ++i)
+  {
+    channel.insert(makeMessage(static_cast<uint32_t>(4 - i), i));
+  }
+
+  std::vector<int> ids;
+  for (const auto& msg : channel)
+  {
+    ids.push_back(msg.noteParam.noteNumber);
+  }
+  EXPECT_EQ(ids, getIds(channel));
+  EXPECT_EQ(static_cast<size_t>(channel.end() - channel.begin()), channel.size());
+  EXPECT_EQ(&channel[2], channel.begin() + 2);
+  EXPECT_EQ(channel[0].sampleOffset, 0u);
+}
+
+TEST(EventBuffer, StandaloneCapacity)
+{
+  // a buffer of its own has room up front, so filling it that far doesn't allocate
+  EventBuffer buffer;
+  buffer.setNumChannels(2);
+  auto* channel = buffer.getChannel(1);
+  ASSERT_NE(channel, nullptr);
+  EXPECT_EQ(channel->capacity(), EventBuffer::DEFAULT_CHANNEL_CAPACITY);
+  channel->insert(makeMessage(0, 0));
+  const auto* data = channel->begin();
+  for (int i = 1; i < static_cast<int>(EventBuffer::DEFAULT_CHANNEL_CAPACITY); ++i)
+  {
+    channel->insert(makeMessage(static_cast<uint32_t>(i), i));
+  }
+  EXPECT_EQ(channel->begin(), data);
+
+  // and can be made bigger ahead of time, without losing anything
+  buffer.setNumChannels(3, 1000);
+  EXPECT_EQ(buffer.getChannel(0)->capacity(), 1000);
+  EXPECT_EQ(buffer.getChannel(2)->capacity(), 1000);
+  EXPECT_EQ(buffer.getNumMessages(1), EventBuffer::DEFAULT_CHANNEL_CAPACITY);
+  buffer.getChannel(0)->reserve(2000);
+  EXPECT_EQ(buffer.getChannel(0)->capacity(), 2000);
+}
@@ -0,0 +1,130 @@
+#include <cmath>
+#include "gtest/gtest.h"
+#include "Test_Common.h"
+#include "../dcAudioGraph/Gain.h"
+#include "../dcAudioGraph/Graph.h"
+
+using namespace dc;
+
+class TestGain : public ::testing::Test
+{
+public:
+  void Init(size_t blockSize, size_t nChannels)
+  {
+    aBuf.resize(blockSize, nChannels);
+    graph.setSampleRate(44100);
+    graph.setBlockSize(blockSize);
+    graph.setNumIo(Audio | Input | Output, nChannels);
+
+    auto gainId = graph.addModule(std::make_unique<Gain>());
+    gain = graph.getModuleById(gainId);
+    ASSERT_NE(gain, nullptr);
+    gain->setNumIo(Audio | Input | Output, nChannels);
+
+    for (size_t cIdx = 0; cIdx < nChannels; ++cIdx)
+    {
+      graph.addConnection({graph.getInputModule()->getId(), cIdx, gainId, cIdx, Connection::Type::Audio});
+      graph.addConnection({gainId, cIdx, graph.getOutputModule()->getId(), cIdx, Connection::Type::Audio});
+    }
+  }
+
+  // runs a block of a constant signal, and checks every sample against the gain the param says it should have
+  void ProcessAndCheck(float input)
+  {
+    aBuf.fill(input);
+    graph.process(aBuf, eBuf);
+
+    auto* param = gain->getParam(0);
+    for (size_t cIdx = 0; cIdx < aBuf.getNumChannels(); ++cIdx)
+    {
+      const auto* cPtr = static_cast<const AudioBuffer&>(aBuf).getChannelPointer(cIdx);
+      for (size_t sIdx = 0; sIdx < aBuf.getNumSamples(); ++sIdx)
+      {
+        const float expected = input * std::pow(10.0f, param->getSmoothedRaw(sIdx) / 20.0f);
+        ASSERT_NEAR(cPtr[sIdx], expected, std::abs(expected) * 1e-3f) << "channel " << cIdx << ", sample " << sIdx;
+      }
+    }
+  }
+
+  Graph graph;
+  Module* gain;
+  AudioBuffer aBuf;
+  EventBuffer eBuf;
+};
+
+TEST_F(TestGain, Unity)
+{
+  Init(64, 2);
+  ProcessAndCheck(0.5f);
+  EXPECT_FLOAT_EQ(aBuf.getPeak(0), 0.5f);
+}
+
+TEST_F(TestGain, Steady)
+{
+  Init(64, 3);
+  gain->getParam(0)->setRaw(-6.0f);
+
+  // the first block fades to the new gain, and it's steady from then on
+  ProcessAndCheck(0.5f);
+  ProcessAndCheck(0.5f);
+  EXPECT_NEAR(aBuf.getPeak(2), 0.5f * std::pow(10.0f, -6.0f / 20.0f), 1e-5f);
+}
+
+TEST_F(TestGain, SilentChannels)
+{
+  Init(64, 3);
+  gain->getParam(0)->setRaw(-6.0f);
+
+  // the gain on the first channel leaves the silent ones after it marked as silent
+  for (int i = 0; i < 2; ++i)
+  {
+    aBuf.zero();
+    aBuf.fill(0, 0.5f);
+    graph.process(aBuf, eBuf);
+    EXPECT_FALSE(aBuf.isSilent(0));
+    EXPECT_TRUE(aBuf.isSilent(1));
+    EXPECT_TRUE(aBuf.isSilent(2));
+    EXPECT_EQ(aBuf.getPeak(1), 0.0f);
+  }
+}
+
+TEST_F(TestGain, Moving)
+{
+  Init(100, 8);
+  for (float db : {-20.0f, -3.0f, -40.0f, -40.0f, 0.0f})
+  {
+    gain->getParam(0)->setRaw(db);
+    ProcessAndCheck(-0.25f);
+  }
+}
+
+TEST_F(TestGain, SampleAccurateControl)
+{
+  Init(64, 2);
+  graph.setNumIo(Event | Input, 1);
+  ASSERT_TRUE(graph.addConnection({graph.getInputModule()->getId(), 0, gain->getId(), 0, Connection::Type::Event}));
+  eBuf.setNumChannels(1);
+
+  // the control input takes the gain from the bottom of its range to the top
+  auto* param = gain->getParam(0);
+  param->setNormalized(0.0f);
+  param->setControlTarget(0.0f);
+  param->setSampleAccurate(true);
+  ProcessAndCheck(0.5f);
+
+  // halfway through the block, the gain steps straight there
+  EventMessage msg(EventMessage::Type::Float, 32);
+  msg.floatParam.value = 1.0f;
+  eBuf.insert(msg, 0);
+  ProcessAndCheck(0.5f);
+  auto* cPtr = static_cast<const AudioBuffer&>(aBuf).getChannelPointer(1);
+  EXPECT_LT(cPtr[0], 0.01f);
+  EXPECT_LT(cPtr[31], 0.01f);
+  EXPECT_NEAR(cPtr[32], 0.5f, 1e-5f);
+  EXPECT_NEAR(cPtr[63], 0.5f, 1e-5f);
+
+  // and stays there
+  eBuf.clear();
+  ProcessAndCheck(0.5f);
+  EXPECT_NEAR(aBuf.getPeak(0), 0.5f, 1e-5f);
+}
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+#include "gtest/gtest.h"
+#include "../dcAudioGraph/GraphTopology.h"
+
+using namespace dc;
+
+namespace
+{
+bool orderIsValid(const GraphTopology& t, const std::vector<std::pair<size_t, size_t>>& edges)
+{
+  std::vector<size_t> order;
+  t.getOrder(order);
+  if (order.size() != t.getNumNodes())
+  {
+    return false;
+  }
+
+  std::unordered_map<size_t, size_t> positions;
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    positions[order[i]] = i;
+  }
+
+  for (auto& e : edges)
+  {
+    if (positions[e.first] >= positions[e.second])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the slow way: everything with a path to a sink
+std::vector<size_t> findLiveNodes(const GraphTopology& t, const std::vector<std::pair<size_t, size_t>>& edges,
+                                  const std::vector<size_t>& sinks)
+{
+  std::unordered_set<size_t> live(sinks.begin(), sinks.end());
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (auto& e : edges)
+    {
+      if (live.count(e.second) > 0 && live.insert(e.first).second)
+      {
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<size_t> order;
+  t.getOrder(order);
+  std::vector<size_t> liveOrder;
+  for (auto id : order)
+  {
+    if (live.count(id) > 0)
+    {
+      liveOrder.push_back(id);
+    }
+  }
+  return liveOrder;
+}
+
+// builds a random DAG whose nodes are added in a different order to their hidden rank,
+// so most edges force a reorder
+void makeRandomDag(GraphTopology& t, size_t numNodes, size_t numEdges, size_t maxSpan,
+                   std::vector<std::pair<size_t, size_t>>& edgesOut, std::mt19937& rng)
+{
+  std::vector<size_t> ids(numNodes);
+  for (size_t i = 0; i < numNodes; ++i)
+  {
+    ids[i] = i + 10;
+  }
+  std::shuffle(ids.begin(), ids.end(), rng);
+  for (auto id : ids)
+  {
+    EXPECT_TRUE(t.addNode(id));
+  }
+
+  // the node with id i + 10 has rank i, and edges only go from a lower to a higher rank
+  std::uniform_int_distribution<size_t> rankDist(0, numNodes - 2);
+  std::uniform_int_distribution<size_t> spanDist(1, maxSpan);
+  for (size_t i = 0; i < numEdges; ++i)
+  {
+    const size_t from = rankDist(rng);
+    const size_t to = std::min(numNodes - 1, from + spanDist(rng));
+    EXPECT_TRUE(t.addEdge(from + 10, to + 10));
+    edgesOut.emplace_back(from + 10, to + 10);
+  }
+}
+}
+
+TEST(GraphTopology, AddRemove)
+{
+  GraphTopology t;
+  EXPECT_TRUE(t.addNode(3));
+  EXPECT_FALSE(t.addNode(3));
+  EXPECT_TRUE(t.addNode(4));
+  EXPECT_TRUE(t.addNode(5));
+  EXPECT_EQ(t.getNumNodes(), 3);
+
+  // 5 -> 4 -> 3 is the reverse of the order they were added
+  EXPECT_TRUE(t.addEdge(4, 3));
+  EXPECT_TRUE(t.addEdge(5, 4));
+  EXPECT_TRUE(orderIsValid(t, {{4, 3}, {5, 4}}));
+
+  // cycles are rejected, and don't disturb anything
+  EXPECT_TRUE(t.edgeCreatesCycle(3, 5));
+  EXPECT_FALSE(t.addEdge(3, 5));
+  EXPECT_FALSE(t.addEdge(3, 3));
+  EXPECT_FALSE(t.edgeCreatesCycle(5, 3));
+  EXPECT_TRUE(orderIsValid(t, {{4, 3}, {5, 4}}));
+
+  // edges are counted
+  EXPECT_TRUE(t.addEdge(4, 3));
+  EXPECT_TRUE(t.removeEdge(4, 3));
+  EXPECT_TRUE(t.edgeCreatesCycle(3, 4));
+  EXPECT_TRUE(t.removeEdge(4, 3));
+  EXPECT_FALSE(t.removeEdge(4, 3));
+  EXPECT_FALSE(t.edgeCreatesCycle(3, 4));
+
+  EXPECT_TRUE(t.removeNode(4));
+  EXPECT_FALSE(t.removeNode(4));
+  EXPECT_FALSE(t.addEdge(5, 4));
+  EXPECT_EQ(t.getNumNodes(), 2);
+  EXPECT_TRUE(t.addEdge(3, 5));
+  EXPECT_TRUE(orderIsValid(t, {{3, 5}}));
+
+  t.clear();
+  EXPECT_EQ(t.getNumNodes(), 0);
+}
+
+TEST(GraphTopology, RandomDag)
+{
+  std::mt19937 rng(1234);
+  GraphTopology t;
+  std::vector<std::pair<size_t, size_t>> edges;
+  makeRandomDag(t, 2000, 6000, 2000, edges, rng);
+  EXPECT_TRUE(orderIsValid(t, edges));
+
+  // anything going back down the ranks closes a loop
+  for (size_t i = 0; i < 100; ++i)
+  {
+    const auto& e = edges[i];
+    EXPECT_TRUE(t.edgeCreatesCycle(e.second, e.first));
+    EXPECT_FALSE(t.addEdge(e.second, e.first));
+  }
+  EXPECT_TRUE(orderIsValid(t, edges));
+
+  // remove a chunk of nodes and their edges, and the order should hold up
+  for (size_t id = 10; id < 1010; id += 2)
+  {
+    EXPECT_TRUE(t.removeNode(id));
+  }
+  edges.erase(std::remove_if(edges.begin(), edges.end(), [](const std::pair<size_t, size_t>& e)
+  {
+    return (e.first < 1010 && e.first % 2 == 0) || (e.second < 1010 && e.second % 2 == 0);
+  }), edges.end());
+  EXPECT_EQ(t.getNumNodes(), 1500);
+  EXPECT_TRUE(orderIsValid(t, edges));
+}
+
+TEST(GraphTopology, Liveness)
+{
+  GraphTopology t;
+  for (size_t id = 1; id <= 4; ++id)
+  {
+    EXPECT_TRUE(t.addNode(id));
+  }
+  EXPECT_FALSE(t.addSink(5));
+  EXPECT_FALSE(t.removeSink(1));
+
+  // 1 -> 2 -> 3, and 4 on its own
+  EXPECT_TRUE(t.addEdge(1, 2));
+  EXPECT_TRUE(t.addEdge(2, 3));
+  EXPECT_FALSE(t.isLive(1));
+  EXPECT_TRUE(t.addSink(3));
+  EXPECT_TRUE(t.isLive(1));
+  EXPECT_TRUE(t.isLive(2));
+  EXPECT_FALSE(t.isLive(4));
+
+  std::vector<size_t> order;
+  t.getLiveOrder(order);
+  EXPECT_EQ(order, std::vector<size_t>({1, 2, 3}));
+
+  // counted edges and sinks only go dead once the last one is gone
+  EXPECT_TRUE(t.addEdge(1, 2));
+  EXPECT_TRUE(t.removeEdge(1, 2));
+  EXPECT_TRUE(t.isLive(1));
+  EXPECT_TRUE(t.addSink(3));
+  EXPECT_TRUE(t.removeSink(3));
+  EXPECT_TRUE(t.isLive(1));
+  EXPECT_TRUE(t.removeSink(3));
+  EXPECT_FALSE(t.isLive(1));
+  EXPECT_FALSE(t.isLive(3));
+
+  // removing a live node takes its inputs with it, unless they're live some other way
+  EXPECT_TRUE(t.addSink(3));
+  EXPECT_TRUE(t.addEdge(1, 4));
+  EXPECT_TRUE(t.addSink(4));
+  EXPECT_TRUE(t.removeNode(3));
+  EXPECT_FALSE(t.isLive(2));
+  EXPECT_TRUE(t.isLive(1));
+  EXPECT_TRUE(t.removeNode(4));
+  EXPECT_FALSE(t.isLive(1));
+}
+
+TEST(GraphTopology, RandomLiveness)
+{
+  std::mt19937 rng(4321);
+  GraphTopology t;
+  std::vector<std::pair<size_t, size_t>> edges;
+  const size_t numNodes = 500;
+  makeRandomDag(t, numNodes, 600, 20, edges, rng);
+
+  std::vector<size_t> sinks;
+  std::uniform_int_distribution<size_t> nodeDist(10, numNodes + 9);
+  for (size_t i = 0; i < 10; ++i)
+  {
+    sinks.push_back(nodeDist(rng));
+    EXPECT_TRUE(t.addSink(sinks.back()));
+  }
+
+  std::vector<size_t> order;
+  t.getLiveOrder(order);
+  EXPECT_EQ(order, findLiveNodes(t, edges, sinks));
+
+  // mix up edge and sink edits, and check every so often
+  std::uniform_int_distribution<size_t> actionDist(0, 3);
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    switch (actionDist(rng))
+    {
+      case 0:
+        if (!edges.empty())
+        {
+          std::uniform_int_distribution<size_t> edgeDist(0, edges.size() - 1);
+          const size_t idx = edgeDist(rng);
+          EXPECT_TRUE(t.removeEdge(edges[idx].first, edges[idx].second));
+          edges.erase(edges.begin() + idx);
+        }
+        break;
+      case 1:
+      {
+        const size_t from = nodeDist(rng);
+        const size_t to = nodeDist(rng);
+        if (from < to && t.addEdge(from, to))
+        {
+          edges.emplace_back(from, to);
+        }
+        break;
+      }
+      case 2:
+        sinks.push_back(nodeDist(rng));
+        EXPECT_TRUE(t.addSink(sinks.back()));
+        break;
+      default:
+        if (!sinks.empty())
+        {
+          std::uniform_int_distribution<size_t> sinkDist(0, sinks.size() - 1);
+          const size_t idx = sinkDist(rng);
+          EXPECT_TRUE(t.removeSink(sinks[idx]));
+          sinks.erase(sinks.begin() + idx);
+        }
+        break;
+    }
+
+    if (i % 50 == 0)
+    {
+      t.getLiveOrder(order);
+      ASSERT_EQ(order, findLiveNodes(t, edges, sinks)) << "after " << i << " edits";
+    }
+  }
+}
+
+TEST(GraphTopology, Scaling)
+{
+  // Local edits should cost about the same no matter how big the graph is.
+  // Make the same kind of short-span edits on graphs of increasing size, and compare how many nodes each one visits.
+  const size_t numEdits = 2000;
+  double smallestVisits = 0.0;
+
+  for (size_t numNodes : {1000, 10000})
+  {
+    std::mt19937 rng(5678);
+    GraphTopology t;
+    std::vector<std::pair<size_t, size_t>> edges;
+    makeRandomDag(t, numNodes, numNodes * 2, 8, edges, rng);
+    EXPECT_TRUE(orderIsValid(t, edges));
+
+    const size_t visitedBefore = t.getNumNodesVisited();
+    std::uniform_int_distribution<size_t> rankDist(0, numNodes - 9);
+    for (size_t i = 0; i < numEdits; ++i)
+    {
+      const size_t from = rankDist(rng);
+      t.addEdge(from + 10, from + 18);
+      t.removeEdge(from + 10, from + 18);
+    }
+    const double visits = static_cast<double>(t.getNumNodesVisited() - visitedBefore) / numEdits;
+    EXPECT_TRUE(orderIsValid(t, edges));
+
+    if (smallestVisits == 0.0)
+    {
+      smallestVisits = visits;
+    }
+    else
+    {
+      // a full re-sort per edit would be ~10x
+      EXPECT_LT(visits, smallestVisits * 5.0) << "with " << numNodes << " nodes";
+    }
+  }
+}
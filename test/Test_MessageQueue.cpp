@@ -0,0 +1,220 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../dcAudioGraph/MessageQueue.h"
+#include "../dcAudioGraph/MultiProducerMessageQueue.h"
+
+using namespace dc;
+
+TEST(MessageQueue, Basic)
+{
+  // not a power of two, so the storage is bigger than what's allowed in it
+  MessageQueue<int> q(5);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.capacity(), 5);
+
+  // go around a few times
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 10; ++round)
+  {
+    while (q.push(next))
+    {
+      ++next;
+    }
+    EXPECT_TRUE(q.full());
+    EXPECT_EQ(q.numMessages(), 5);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      int msg = -1;
+      EXPECT_TRUE(q.pop(msg));
+      EXPECT_EQ(msg, expected++);
+    }
+  }
+
+  int msg = -1;
+  while (q.pop(msg))
+  {
+    EXPECT_EQ(msg, expected++);
+  }
+  EXPECT_EQ(expected, next);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MessageQueue, Batch)
+{
+  MessageQueue<int> q(8);
+  const std::vector<int> msgs = {0, 1, 2, 3, 4, 5};
+  EXPECT_EQ(q.pushBatch(msgs.data(), msgs.size()), 6);
+
+  // only what fits goes in
+  EXPECT_EQ(q.pushBatch(msgs.data(), msgs.size()), 2);
+  EXPECT_TRUE(q.full());
+
+  std::vector<int> out(10, -1);
+  EXPECT_EQ(q.popBatch(out.data(), 4), 4);
+  EXPECT_EQ(std::vector<int>(out.begin(), out.begin() + 4), std::vector<int>({0, 1, 2, 3}));
+
+  // wraps around the end of the storage
+  EXPECT_EQ(q.pushBatch(msgs.data(), 3), 3);
+  EXPECT_EQ(q.popBatch(out.data(), out.size()), 7);
+  EXPECT_EQ(std::vector<int>(out.begin(), out.begin() + 7), std::vector<int>({4, 5, 0, 1, 0, 1, 2}));
+  EXPECT_EQ(q.popBatch(out.data(), out.size()), 0);
+}
+
+TEST(MessageQueue, Multithreaded)
+{
+  MessageQueue<size_t> q(64);
+  const size_t numMessages = 1000000;
+
+  std::thread producer([&]()
+                       {
+                         size_t next = 0;
+                         size_t batch[16];
+                         while (next < numMessages)
+                         {
+                           // mix single and batched pushes
+                           size_t numPushed = 0;
+                           if (next % 3 == 0)
+                           {
+                             numPushed = q.push(next) ? 1 : 0;
+                           }
+                           else
+                           {
+                             size_t numInBatch = 0;
+                             while (numInBatch < 16 && next + numInBatch < numMessages)
+                             {
+                               batch[numInBatch] = next + numInBatch;
+                               ++numInBatch;
+                             }
+                             numPushed = q.pushBatch(batch, numInBatch);
+                           }
+                           next += numPushed;
+
+                           // in case there's only one core
+                           if (numPushed == 0)
+                           {
+                             std::this_thread::yield();
+                           }
+                         }
+                       });
+
+  size_t expected = 0;
+  bool inOrder = true;
+  size_t batch[7];
+  while (expected < numMessages)
+  {
+    const size_t numPopped = q.popBatch(batch, 7);
+    for (size_t i = 0; i < numPopped; ++i)
+    {
+      inOrder = inOrder && batch[i] == expected;
+      ++expected;
+    }
+    if (numPopped == 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(inOrder);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MultiProducerMessageQueue, Basic)
+{
+  MultiProducerMessageQueue<int> q(5);
+  EXPECT_TRUE(q.empty());
+
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 10; ++round)
+  {
+    while (q.push(next))
+    {
+      ++next;
+    }
+    EXPECT_TRUE(q.full());
+    EXPECT_EQ(q.numMessages(), 5);
+
+    std::vector<int> out(3);
+    EXPECT_EQ(q.popBatch(out.data(), out.size()), 3);
+    EXPECT_EQ(out, std::vector<int>({expected, expected + 1, expected + 2}));
+    expected += 3;
+  }
+
+  int msg = -1;
+  while (q.pop(msg))
+  {
+    EXPECT_EQ(msg, expected++);
+  }
+  EXPECT_EQ(expected, next);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MultiProducerMessageQueue, Multithreaded)
+{
+  struct Message
+  {
+    size_t producer;
+    size_t sequence;
+  };
+
+  const size_t numProducers = 4;
+  const size_t numPerProducer = 200000;
+  MultiProducerMessageQueue<Message> q(64);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < numProducers; ++p)
+  {
+    producers.emplace_back([&q, p]()
+                           {
+                             Message batch[8];
+                             size_t next = 0;
+                             while (next < numPerProducer)
+                             {
+                               size_t numInBatch = 0;
+                               for (; numInBatch < 8 && next + numInBatch < numPerProducer; ++numInBatch)
+                               {
+                                 batch[numInBatch] = {p, next + numInBatch};
+                               }
+                               // odd producers push one at a time
+                               const size_t numPushed = p % 2 ? (q.push(batch[0]) ? 1 : 0)
+                                                              : q.pushBatch(batch, numInBatch);
+                               next += numPushed;
+                               if (numPushed == 0)
+                               {
+                                 std::this_thread::yield();
+                               }
+                             }
+                           });
+  }
+
+  // each producer's messages come out in the order it sent them, with nothing lost or repeated
+  std::vector<size_t> expected(numProducers, 0);
+  bool inOrder = true;
+  size_t numReceived = 0;
+  Message batch[5];
+  while (numReceived < numProducers * numPerProducer)
+  {
+    const size_t numPopped = q.popBatch(batch, 5);
+    for (size_t i = 0; i < numPopped; ++i)
+    {
+      inOrder = inOrder && batch[i].producer < numProducers && batch[i].sequence == expected[batch[i].producer]++;
+    }
+    numReceived += numPopped;
+    if (numPopped == 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+
+  EXPECT_TRUE(inOrder);
+  EXPECT_EQ(expected, std::vector<size_t>(numProducers, numPerProducer));
+  EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,299 @@
+#include <cmath>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Test_Common.h"
+#include "../dcAudioGraph/CurveTable.h"
+#include "../dcAudioGraph/ModuleParam.h"
+
+using namespace dc;
+
+namespace
+{
+float getNormalizedSquared(float rawValue, float min, float max)
+{
+  const float pct = (rawValue - min) / (max - min);
+  return pct * pct;
+}
+
+float getRawSquared(float normalizedValue, float min, float max)
+{
+  return min + (max - min) * std::sqrt(normalizedValue);
+}
+
+float dbToLin(float db)
+{
+  return std::pow(10.0f, db / 20.0f);
+}
+
+// renders a few blocks with the param moving around, and checks the block version against the per-sample one
+void expectBlocksMatch(ModuleParam& param, size_t blockSize)
+{
+  std::vector<float> block(blockSize);
+  const float values[] = {0.0f, 0.8f, 0.8f, 0.3f, 1.0f};
+  const float inputs[] = {0.0f, 0.5f, 1.0f, 1.0f, 0.2f};
+
+  for (size_t i = 0; i < 5; ++i)
+  {
+    param.setNormalized(values[i]);
+    param.setControlTarget(param.getRange().getRaw(1.0f - values[i]));
+    param.updateSmoothing(blockSize);
+    if (param.hasControlInput())
+    {
+      param.setControlInput(inputs[i]);
+    }
+
+    param.getSmoothedRaw(block.data(), blockSize);
+    for (size_t sIdx = 0; sIdx < blockSize; ++sIdx)
+    {
+      ASSERT_TRUE(samplesEqual(param.getSmoothedRaw(sIdx), block[sIdx]))
+        << param.getId() << ", block " << i << " of " << blockSize << ", sample " << sIdx;
+    }
+  }
+}
+}
+
+TEST(ModuleParam, BlockMatchesPerSample)
+{
+  std::vector<ModuleParam> params = {
+    ModuleParam("linear", "", ParamRange(-1.0f, 1.0f, 0.0f)),
+    ModuleParam("stepped", "", ParamRange(0.0f, 10.0f, 0.5f), false, 0),
+    ModuleParam("reversed", "", ParamRange(1.0f, -1.0f, 0.0f), false, 0),
+    ModuleParam("curved", "", ParamRange(-70.0f, 0.0f, 0.0f, getNormalizedSquared, getRawSquared), false, 0)
+  };
+
+  // small blocks, odd ones, and ones bigger than the chunks the control blend is done in
+  for (size_t blockSize : {1, 7, 64, 300, 1024})
+  {
+    for (auto& param : params)
+    {
+      expectBlocksMatch(param, blockSize);
+    }
+  }
+}
+
+TEST(ModuleParam, Steady)
+{
+  ModuleParam param("param", "", ParamRange(0.0f, 10.0f, 0.0f), false, 0, 5.0f);
+  param.updateSmoothing(16);
+  EXPECT_FALSE(param.isSmoothing());
+
+  param.setRaw(8.0f);
+  param.updateSmoothing(16);
+  EXPECT_TRUE(param.isSmoothing());
+
+  param.updateSmoothing(16);
+  EXPECT_FALSE(param.isSmoothing());
+  std::vector<float> block(16, 0.0f);
+  param.getSmoothedRaw(block.data(), block.size());
+  EXPECT_EQ(block, std::vector<float>(16, 8.0f));
+
+  // moving the control input moves the value too
+  param.setControlInput(1.0f);
+  param.updateSmoothing(16);
+  EXPECT_TRUE(param.isSmoothing());
+}
+
+TEST(CurveTable, Lookup)
+{
+  auto curve = [](float x) { return std::exp(x); };
+  CurveTable table(curve, -1.0f, 1.0f, 1024);
+
+  // interpolation error is about the point spacing squared / 8 * the curvature, with a little float rounding on top
+  const float spacing = 2.0f / 1023;
+  EXPECT_GT(table.getMaxError(), 0.0f);
+  EXPECT_LT(table.getMaxError(), spacing * spacing / 8 * std::exp(1.0f) + 1e-6f);
+
+  // and the measured error holds everywhere in the table, a block at a time or not
+  std::vector<float> xs(1000);
+  for (size_t i = 0; i < xs.size(); ++i)
+  {
+    xs[i] = -1.0f + 2.0f * i / (xs.size() - 1);
+  }
+  std::vector<float> out(xs.size());
+  table.lookup(xs.data(), out.data(), xs.size());
+  for (size_t i = 0; i < xs.size(); ++i)
+  {
+    ASSERT_LE(std::abs(out[i] - curve(xs[i])), table.getMaxError() + 1e-6f) << xs[i];
+    ASSERT_TRUE(samplesEqual(out[i], table.lookup(xs[i])));
+  }
+
+  // clamped at the ends
+  EXPECT_TRUE(samplesEqual(table.lookup(-5.0f), curve(-1.0f)));
+  EXPECT_TRUE(samplesEqual(table.lookup(5.0f), curve(1.0f)));
+  EXPECT_TRUE(samplesEqual(table.lookup(NAN), curve(-1.0f)));
+}
+
+TEST(ParamRange, Tables)
+{
+  ParamRange range(-70.0f, 0.0f, 0.0f, getNormalizedSquared, getRawSquared);
+  EXPECT_EQ(range.getRawTable(), nullptr);
+  EXPECT_EQ(range.getValue(-6.0f), -6.0f);
+
+  range.buildTables(ParamRange::DEFAULT_TABLE_SIZE, dbToLin);
+  ASSERT_NE(range.getRawTable(), nullptr);
+  ASSERT_NE(range.getValueTable(), nullptr);
+  EXPECT_TRUE(samplesEqual(range.getValue(-6.0f), dbToLin(-6.0f)));
+
+  // The square root curve is steep at the bottom, which is where the raw table is furthest off.
+  // dB to linear gain is smooth, so its table is good to well under the noise floor.
+  EXPECT_LT(range.getRawTable()->getMaxError(), 0.6f);
+  EXPECT_LT(range.getValueTable()->getMaxError(), 1e-5f);
+
+  // copies share the tables
+  ParamRange copy(range);
+  EXPECT_EQ(copy.getRawTable(), range.getRawTable());
+
+  const size_t numValues = 500;
+  std::vector<float> normalized(numValues);
+  for (size_t i = 0; i < numValues; ++i)
+  {
+    normalized[i] = static_cast<float>(i) / (numValues - 1);
+  }
+  std::vector<float> raw(numValues);
+  std::vector<float> values(numValues);
+  range.getRaw(normalized.data(), raw.data(), numValues);
+  range.getValue(raw.data(), values.data(), numValues);
+  for (size_t i = 0; i < numValues; ++i)
+  {
+    const float expectedRaw = range.getRaw(normalized[i]);
+    ASSERT_LE(std::abs(raw[i] - expectedRaw), range.getRawTable()->getMaxError() + 1e-4f) << normalized[i];
+    ASSERT_LE(std::abs(values[i] - dbToLin(raw[i])), range.getValueTable()->getMaxError() + 1e-6f) << raw[i];
+  }
+}
+
+TEST(ModuleParam, SampleAccurate)
+{
+  // with the value at the bottom and the control target at the top, the raw value is the control input
+  ModuleParam param("param", "", ParamRange(0.0f, 1.0f, 0.0f), false, 0, 0.0f);
+  param.setControlTarget(1.0f);
+  param.setSampleAccurate(true);
+  param.updateSmoothing(64);
+  param.updateSmoothing(64);
+  EXPECT_FALSE(param.isSmoothing());
+
+  // holds until each value's own offset, steps to it there, then holds the last one
+  param.updateSmoothing(64);
+  param.addControlInput(16, 1.0f);
+  param.addControlInput(48, 0.5f);
+  EXPECT_TRUE(param.isSmoothing());
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(15), 0.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(16), 1.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(47), 1.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(48), 0.5f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(63), 0.5f);
+
+  std::vector<float> block(64);
+  param.getSmoothedRaw(block.data(), block.size());
+  for (size_t sIdx = 0; sIdx < block.size(); ++sIdx)
+  {
+    ASSERT_TRUE(samplesEqual(param.getSmoothedRaw(sIdx), block[sIdx])) << sIdx;
+  }
+
+  // a block with no input holds it, where the default mode would drop back to 0
+  param.updateSmoothing(64);
+  param.noControlInput();
+  EXPECT_FALSE(param.isSmoothing());
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.5f);
+
+  // a value at the very start of the block jumps straight there, and more values than there's room for
+  // still end up at the last one
+  param.updateSmoothing(600);
+  param.addControlInput(0, 0.25f);
+  for (size_t i = 0; i < ModuleParam::MAX_CONTROL_POINTS * 2; ++i)
+  {
+    param.addControlInput(10 + i * 4, (i % 2) ? 0.0f : 1.0f);
+  }
+  param.addControlInput(590, 0.75f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.25f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(599), 0.75f);
+  block.resize(600);
+  param.getSmoothedRaw(block.data(), block.size());
+  for (size_t sIdx = 0; sIdx < block.size(); ++sIdx)
+  {
+    ASSERT_TRUE(samplesEqual(param.getSmoothedRaw(sIdx), block[sIdx])) << sIdx;
+  }
+}
+
+TEST(ModuleParam, SampleAccurateBlockSizes)
+{
+  // the same input in blocks of different sizes comes out the same
+  const size_t numSamples = 256;
+  const size_t offsets[] = {5, 40, 64, 100, 127, 128, 129, 200};
+  std::vector<float> expected;
+
+  for (size_t blockSize : {16, 64, 256})
+  {
+    ModuleParam param("param", "", ParamRange(0.0f, 1.0f, 0.0f), false, 0, 0.0f);
+    param.setControlTarget(1.0f);
+    param.setSampleAccurate(true);
+    param.updateSmoothing(blockSize);
+
+    std::vector<float> out(numSamples);
+    size_t pointIdx = 0;
+    for (size_t start = 0; start < numSamples; start += blockSize)
+    {
+      param.updateSmoothing(blockSize);
+      for (; pointIdx < 8 && offsets[pointIdx] < start + blockSize; ++pointIdx)
+      {
+        param.addControlInput(offsets[pointIdx] - start, (pointIdx + 1) / 8.0f);
+      }
+      param.getSmoothedRaw(out.data() + start, blockSize);
+    }
+
+    if (expected.empty())
+    {
+      expected = out;
+      EXPECT_FLOAT_EQ(expected[4], 0.0f);
+      EXPECT_FLOAT_EQ(expected[5], 1.0f / 8.0f);
+      EXPECT_FLOAT_EQ(expected[127], 5.0f / 8.0f);
+      EXPECT_FLOAT_EQ(expected[128], 6.0f / 8.0f);
+      EXPECT_FLOAT_EQ(expected[255], 1.0f);
+    }
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      ASSERT_TRUE(samplesEqual(out[sIdx], expected[sIdx])) << "block size " << blockSize << ", sample " << sIdx;
+    }
+  }
+}
+
+TEST(ModuleParam, ScheduledValues)
+{
+  ModuleParam param("param", "", ParamRange(0.0f, 1.0f, 0.0f), false, -1, 0.0f);
+  param.updateSmoothing(64);
+  EXPECT_FALSE(param.isSmoothing());
+
+  // the value holds until each one's own offset, steps to it there, then holds the last one,
+  // instead of smoothing over the block
+  param.scheduleRaw(16, 1.0f);
+  param.scheduleRaw(48, 0.5f);
+  EXPECT_EQ(param.getRaw(), 0.5f);
+  param.updateSmoothing(64);
+  EXPECT_TRUE(param.isSmoothing());
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(15), 0.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(16), 1.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(47), 1.0f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(48), 0.5f);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(63), 0.5f);
+
+  std::vector<float> block(64);
+  param.getSmoothedRaw(block.data(), block.size());
+  for (size_t sIdx = 0; sIdx < block.size(); ++sIdx)
+  {
+    ASSERT_TRUE(samplesEqual(param.getSmoothedRaw(sIdx), block[sIdx])) << sIdx;
+  }
+
+  // and the next block carries on from there
+  param.updateSmoothing(64);
+  EXPECT_FALSE(param.isSmoothing());
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.5f);
+
+  // offsets past the end of the block land at the start of the next one
+  param.scheduleRaw(100, 0.0f);
+  param.updateSmoothing(64);
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(63), 0.5f);
+  param.updateSmoothing(64);
+  EXPECT_FALSE(param.isSmoothing());
+  EXPECT_FLOAT_EQ(param.getSmoothedRaw(0), 0.0f);
+}
@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "gtest/gtest.h"
 #include "Test_Common.h"
 #include "../dcAudioGraph/Graph.h"
@@ -108,6 +115,46 @@ TEST(Graph, AddRemove)
   EXPECT_EQ(g.getModuleById(id), nullptr);
 }
 
+TEST(Graph, ModuleIds)
+{
+  Graph g;
+  std::vector<size_t> ids;
+  for (int i = 0; i < 10; ++i)
+  {
+    ids.push_back(g.addModule(std::make_unique<Module>()));
+  }
+
+  // taking some out of the middle and the ends leaves the rest where they were, in order
+  EXPECT_TRUE(g.removeModuleById(ids[0]));
+  EXPECT_TRUE(g.removeModuleById(ids[4]));
+  EXPECT_TRUE(g.removeModuleAt(g.getNumModules() - 1));
+  EXPECT_FALSE(g.removeModuleById(ids[4]));
+  EXPECT_EQ(g.getModuleById(ids[0]), nullptr);
+  EXPECT_EQ(g.getModuleById(ids[4]), nullptr);
+  EXPECT_EQ(g.getModuleById(ids[9]), nullptr);
+  ASSERT_EQ(g.getNumModules(), 7);
+  for (size_t i = 0; i < g.getNumModules(); ++i)
+  {
+    auto* m = g.getModuleAt(i);
+    EXPECT_EQ(g.getModuleById(m->getId()), m);
+  }
+
+  // an id that's free can be used again, but not one that's taken
+  EXPECT_EQ(g.addModule(std::make_unique<Module>(), ids[4]), ids[4]);
+  EXPECT_EQ(g.getModuleById(ids[4]), g.getModuleAt(g.getNumModules() - 1));
+  EXPECT_EQ(g.addModule(std::make_unique<Module>(), ids[5]), 0);
+
+  g.clear();
+  EXPECT_EQ(g.getNumModules(), 0);
+  for (auto id : ids)
+  {
+    EXPECT_EQ(g.getModuleById(id), nullptr);
+  }
+  // ids aren't handed out again, but can still be asked for
+  EXPECT_GT(g.addModule(std::make_unique<Module>()), ids.back());
+  EXPECT_EQ(g.addModule(std::make_unique<Module>(), ids[0]), ids[0]);
+}
+
 TEST(Graph, SetNumIo)
 {
   Graph g;
@@ -180,3 +227,1068 @@ TEST(Graph, Connections)
   g.disconnectModule(in->getId());
   EXPECT_EQ(g.getNumConnections(), 0);
 }
+
+TEST(Graph, DisconnectMany)
+{
+  const size_t numSources = 16;
+  const size_t blockSize = 16;
+  Graph g;
+  std::vector<size_t> sources;
+  size_t hubId = 0;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(blockSize);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, 1);
+
+    auto hub = std::make_unique<Module>();
+    hub->setNumIo(Audio | Input, numSources);
+    hub->setNumIo(Audio | Output, numSources);
+    hubId = g.addModule(std::move(hub));
+
+    // each source is fed by the graph, and feeds the hub, which feeds them all to the output
+    for (size_t i = 0; i < numSources; ++i)
+    {
+      auto m = std::make_unique<Module>();
+      m->setNumIo(Audio | Input | Output, 1);
+      sources.push_back(g.addModule(std::move(m)));
+      EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, sources[i], 0, Connection::Type::Audio}));
+      EXPECT_TRUE(g.addConnection({sources[i], 0, hubId, i, Connection::Type::Audio}));
+      EXPECT_TRUE(g.addConnection({hubId, i, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+    }
+  }
+  EXPECT_EQ(g.getNumConnections(), 3 * numSources);
+
+  AudioBuffer audio(blockSize, 1);
+  EventBuffer events;
+  audio.fill(0.5f);
+  g.process(audio, events);
+  EXPECT_FLOAT_EQ(audio.getChannelPointer(0)[0], 0.5f * numSources);
+
+  // only the hub's connections go, and every connection that's left can still be found
+  g.disconnectModule(hubId);
+  EXPECT_EQ(g.getNumConnections(), numSources);
+  for (size_t i = 0; i < g.getNumConnections(); ++i)
+  {
+    Connection c{};
+    ASSERT_TRUE(g.getConnection(i, c));
+    EXPECT_TRUE(g.connectionExists(c));
+    EXPECT_NE(c.toId, hubId);
+    EXPECT_NE(c.fromId, hubId);
+  }
+  EXPECT_FALSE(g.connectionExists({sources[3], 0, hubId, 3, Connection::Type::Audio}));
+  audio.fill(0.5f);
+  g.process(audio, events);
+  EXPECT_TRUE(audio.isSilent());
+
+  // they can be made again, and removing a module takes its connections with it
+  EXPECT_TRUE(g.addConnection({sources[3], 0, hubId, 3, Connection::Type::Audio}));
+  EXPECT_TRUE(g.addConnection({hubId, 3, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  EXPECT_TRUE(g.removeModuleById(sources[3]));
+  EXPECT_EQ(g.getNumConnections(), numSources);
+  EXPECT_FALSE(g.connectionExists({sources[3], 0, hubId, 3, Connection::Type::Audio}));
+  EXPECT_TRUE(g.connectionExists({hubId, 3, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+}
+
+void makeWideGraph(Graph& g, size_t numIo, size_t numChains, size_t chainLength)
+{
+  g.setNumIo(Audio | Input | Output, numIo);
+
+  auto* aIn = g.getInputModule();
+  auto* aOut = g.getOutputModule();
+
+  for (size_t chainIdx = 0; chainIdx < numChains; ++chainIdx)
+  {
+    size_t prevId = aIn->getId();
+    for (size_t linkIdx = 0; linkIdx < chainLength; ++linkIdx)
+    {
+      const auto gId = g.addModule(std::make_unique<Gain>());
+      auto* gain = g.getModuleById(gId);
+      ASSERT_NE(gain, nullptr);
+      gain->setNumIo(Audio | Input | Output, numIo);
+      gain->getParam(0)->setRaw(-1.0f * ((chainIdx + linkIdx) % 12));
+
+      for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+      {
+        EXPECT_TRUE(g.addConnection({prevId, cIdx, gId, cIdx, Connection::Type::Audio}));
+      }
+      prevId = gId;
+    }
+
+    for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+    {
+      EXPECT_TRUE(g.addConnection({prevId, cIdx, aOut->getId(), cIdx, Connection::Type::Audio}));
+    }
+  }
+}
+
+TEST(Graph, ParallelMatchesSerial)
+{
+  const size_t numSamples = 256;
+  const size_t numIo = 2;
+
+  Graph serial;
+  serial.setBlockSize(numSamples);
+  serial.setSampleRate(44100);
+  makeWideGraph(serial, numIo, 16, 4);
+
+  Graph parallel;
+  parallel.setBlockSize(numSamples);
+  parallel.setSampleRate(44100);
+  makeWideGraph(parallel, numIo, 16, 4);
+  parallel.setNumWorkerThreads(3);
+  EXPECT_EQ(parallel.getNumWorkerThreads(), 3);
+
+  AudioBuffer input(numSamples, numIo);
+  for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+  {
+    auto* cPtr = input.getChannelPointer(cIdx);
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      cPtr[sIdx] = std::sin(0.01f * sIdx * (cIdx + 1));
+    }
+  }
+
+  EventBuffer events;
+  AudioBuffer serialOut;
+  AudioBuffer parallelOut;
+
+  for (int i = 0; i < 100; ++i)
+  {
+    serialOut.copyFrom(input, true);
+    parallelOut.copyFrom(input, true);
+    serial.process(serialOut, events);
+    parallel.process(parallelOut, events);
+
+    for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+    {
+      EXPECT_EQ(0, memcmp(serialOut.getChannelPointer(cIdx), parallelOut.getChannelPointer(cIdx),
+                          numSamples * sizeof(float)));
+    }
+  }
+
+  // switching back to serial processing works too
+  parallel.setNumWorkerThreads(0);
+  parallelOut.copyFrom(input, true);
+  serialOut.copyFrom(input, true);
+  serial.process(serialOut, events);
+  parallel.process(parallelOut, events);
+  EXPECT_TRUE(buffersEqual(serialOut, parallelOut));
+}
+
+TEST(Graph, WorkerThreadSetup)
+{
+  const size_t numSamples = 64;
+  const size_t numIo = 4;
+
+  Graph serial;
+  serial.setBlockSize(numSamples);
+  serial.setSampleRate(44100);
+  makeWideGraph(serial, numIo, 16, 4);
+
+  Graph parallel;
+  parallel.setBlockSize(numSamples);
+  parallel.setSampleRate(44100);
+  makeWideGraph(parallel, numIo, 16, 4);
+
+  // every worker is set up on its own thread before setNumWorkerThreads returns
+  std::mutex mutex;
+  std::vector<size_t> workerIndices;
+  std::vector<std::thread::id> threadIds;
+  parallel.setNumWorkerThreads(2, [&](size_t workerIndex)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    workerIndices.push_back(workerIndex);
+    threadIds.push_back(std::this_thread::get_id());
+  });
+  ASSERT_EQ(workerIndices.size(), 2);
+  std::sort(workerIndices.begin(), workerIndices.end());
+  EXPECT_EQ(workerIndices, (std::vector<size_t>{1, 2}));
+  EXPECT_NE(threadIds[0], threadIds[1]);
+  EXPECT_NE(threadIds[0], std::this_thread::get_id());
+  EXPECT_NE(threadIds[1], std::this_thread::get_id());
+
+  AudioBuffer input(numSamples, numIo);
+  for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+  {
+    auto* cPtr = input.getChannelPointer(cIdx);
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      cPtr[sIdx] = std::sin(0.01f * sIdx * (cIdx + 1));
+    }
+  }
+
+  // the workers still pick up blocks after they've gone to sleep
+  EventBuffer events;
+  AudioBuffer serialOut;
+  AudioBuffer parallelOut;
+  for (int i = 0; i < 3; ++i)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    serialOut.copyFrom(input, true);
+    parallelOut.copyFrom(input, true);
+    serial.process(serialOut, events);
+    parallel.process(parallelOut, events);
+    EXPECT_TRUE(buffersEqual(serialOut, parallelOut));
+  }
+}
+
+TEST(Graph, BufferPool)
+{
+  const size_t numSamples = 64;
+  const size_t numIo = 2;
+  const size_t numModules = 200;
+
+  // a long chain only ever needs a couple of buffers at a time
+  Graph g;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(numSamples);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, numIo);
+
+    size_t prevId = g.getInputModule()->getId();
+    for (size_t i = 0; i < numModules; ++i)
+    {
+      auto gain = std::make_unique<Gain>();
+      gain->setNumIo(Audio | Input | Output, numIo);
+      const auto id = g.addModule(std::move(gain));
+      for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+      {
+        EXPECT_TRUE(g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio}));
+      }
+      prevId = id;
+    }
+    for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+    {
+      EXPECT_TRUE(g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio}));
+    }
+  }
+
+  const size_t bufferSize = numSamples * numIo * sizeof(float);
+  EXPECT_EQ(g.getUnpooledAudioMemory(), bufferSize * (numModules + 2));
+  EXPECT_LE(g.getPooledAudioMemory(), bufferSize * 2);
+
+  AudioBuffer input(numSamples, numIo);
+  for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+  {
+    auto* cPtr = input.getChannelPointer(cIdx);
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      cPtr[sIdx] = std::sin(0.01f * sIdx * (cIdx + 1));
+    }
+  }
+
+  EventBuffer events;
+  AudioBuffer buffer;
+  for (int i = 0; i < 10; ++i)
+  {
+    buffer.copyFrom(input, true);
+    g.process(buffer, events);
+    EXPECT_TRUE(buffersEqual(buffer, input));
+  }
+
+  // worker threads get a buffer per module,
+  // except for the output module, which reads straight out of the last gain's buffer
+  g.setNumWorkerThreads(1);
+  EXPECT_EQ(g.getPooledAudioMemory(), g.getUnpooledAudioMemory() - bufferSize);
+  buffer.copyFrom(input, true);
+  g.process(buffer, events);
+  EXPECT_TRUE(buffersEqual(buffer, input));
+}
+
+TEST(Graph, EventPool)
+{
+  const size_t capacity = 8;
+  const size_t numModules = 10;
+
+  // a chain of modules that pass their events straight through
+  Graph g;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(64);
+    g.setSampleRate(44100);
+    g.setNumIo(Event | Input | Output, 1);
+    g.setEventChannelCapacity(capacity);
+
+    size_t prevId = g.getInputModule()->getId();
+    for (size_t i = 0; i < numModules; ++i)
+    {
+      auto m = std::make_unique<Module>();
+      m->setNumIo(Event | Input | Output, 1);
+      const auto id = g.addModule(std::move(m));
+      EXPECT_TRUE(g.addConnection({prevId, 0, id, 0, Connection::Type::Event}));
+      prevId = id;
+    }
+    EXPECT_TRUE(g.addConnection({prevId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Event}));
+  }
+
+  // a channel each for the modules and the graph's input and output
+  EXPECT_EQ(g.getEventPoolMemory(), (numModules + 2) * capacity * sizeof(EventMessage));
+
+  AudioBuffer audio;
+  EventBuffer events;
+  events.setNumChannels(1);
+  auto sendEvents = [&](size_t numEvents)
+  {
+    events.clear();
+    for (size_t i = 0; i < numEvents; ++i)
+    {
+      events.insert(EventMessage(EventMessage::Type::Trigger, numEvents - 1 - i), 0);
+    }
+    g.process(audio, events);
+
+    ASSERT_EQ(events.getNumMessages(0), std::min(numEvents, capacity));
+    auto it = events.getIterator(0);
+    EventMessage msg;
+    size_t expectedOffset = 0;
+    while (it.next(msg))
+    {
+      EXPECT_EQ(msg.sampleOffset, expectedOffset++);
+    }
+  };
+
+  // what fits doesn't allocate
+  sendEvents(capacity);
+  EXPECT_EQ(g.getNumEventOverflows(), 0);
+
+  // what doesn't fit is dropped where it comes in, keeping the earliest, and each message dropped is counted
+  sendEvents(capacity * 3);
+  EXPECT_EQ(g.getNumEventOverflows(), capacity * 2);
+
+  // the channels don't grow to make room
+  sendEvents(capacity * 2);
+  EXPECT_EQ(g.getNumEventOverflows(), capacity * 3);
+  EXPECT_EQ(g.getEventPoolMemory(), (numModules + 2) * capacity * sizeof(EventMessage));
+}
+
+TEST(Graph, FanInAndAliases)
+{
+  const size_t numSamples = 64;
+  const size_t numIo = 2;
+
+  Graph g;
+  size_t meterId = 0;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(numSamples);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, numIo);
+    const auto inId = g.getInputModule()->getId();
+    const auto outId = g.getOutputModule()->getId();
+
+    auto addModule = [&](std::unique_ptr<Module> m)
+    {
+      m->setNumIo(Audio | Input | Output, numIo);
+      return g.addModule(std::move(m));
+    };
+
+    // in -> a -> meter -> c, where the meter reads straight out of a's buffer,
+    // so a's buffer has to stay put until c and the output are done with the meter.
+    // c only gets channel 0, so it would clear the meter's channel 1 if it ended up in the same memory.
+    const auto aId = addModule(std::make_unique<Gain>());
+    meterId = addModule(std::make_unique<LevelMeter>());
+    const auto cId = addModule(std::make_unique<Gain>());
+    // b only gets channel 0, so its channel 1 has to be cleared
+    const auto bId = addModule(std::make_unique<Gain>());
+
+    for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+    {
+      EXPECT_TRUE(g.addConnection({inId, cIdx, aId, cIdx, Connection::Type::Audio}));
+      EXPECT_TRUE(g.addConnection({aId, cIdx, meterId, cIdx, Connection::Type::Audio}));
+      EXPECT_TRUE(g.addConnection({meterId, cIdx, outId, cIdx, Connection::Type::Audio}));
+      EXPECT_TRUE(g.addConnection({bId, cIdx, outId, cIdx, Connection::Type::Audio}));
+    }
+    EXPECT_TRUE(g.addConnection({inId, 0, bId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({meterId, 0, cId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({cId, 0, outId, 0, Connection::Type::Audio}));
+  }
+
+  AudioBuffer input(numSamples, numIo);
+  for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+  {
+    auto* cPtr = input.getChannelPointer(cIdx);
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      cPtr[sIdx] = 0.5f * std::sin(0.01f * sIdx * (cIdx + 1));
+    }
+  }
+
+  // out 0 = meter + b + c = 3 * in 0, out 1 = meter + nothing from b = in 1
+  AudioBuffer expected(input);
+  expected.applyGain(0, 3.0f);
+
+  EventBuffer events;
+  AudioBuffer buffer;
+  for (int i = 0; i < 4; ++i)
+  {
+    buffer.copyFrom(input, true);
+    g.process(buffer, events);
+    EXPECT_TRUE(buffersEqual(buffer, expected));
+  }
+
+  auto* meter = dynamic_cast<LevelMeter*>(g.getModuleById(meterId));
+  ASSERT_NE(meter, nullptr);
+  EXPECT_TRUE(samplesEqual(meter->getLevel(1), input.getPeak(1)));
+}
+
+namespace
+{
+// reads its input, and counts the blocks where a channel flagged as silent wasn't
+class SilenceChecker : public Module
+{
+public:
+  SilenceChecker()
+  {
+    setNumIo(Audio | Input, 1);
+  }
+
+  bool isAudioReadOnly() const override { return true; }
+
+  bool hasSideEffects() const override { return true; }
+
+  size_t numProcessed = 0;
+  size_t numWrongFlags = 0;
+
+protected:
+  void process(ModuleProcessContext& context) override
+  {
+    ++numProcessed;
+    const auto& audio = context.audioBuffer;
+    const float* cPtr = audio.getChannelPointer(0);
+    if (audio.isSilent(0) && std::any_of(cPtr, cPtr + context.blockSize, [](float s) { return s != 0.0f; }))
+    {
+      ++numWrongFlags;
+    }
+  }
+};
+}
+
+TEST(Graph, SharedMemorySilence)
+{
+  const size_t numSamples = 64;
+
+  // The checker sums two silent inputs, so it has a silent buffer of its own that nothing reads after it.
+  // The gain after it can use the same memory, and writes sound into it.
+  Graph g;
+  SilenceChecker* checker = nullptr;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(numSamples);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input, 3);
+    g.setNumIo(Audio | Output, 1);
+    const auto inId = g.getInputModule()->getId();
+
+    const auto checkerId = g.addModule(std::make_unique<SilenceChecker>());
+    checker = dynamic_cast<SilenceChecker*>(g.getModuleById(checkerId));
+    ASSERT_NE(checker, nullptr);
+    EXPECT_TRUE(g.addConnection({inId, 0, checkerId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({inId, 1, checkerId, 0, Connection::Type::Audio}));
+
+    const auto gainId = g.addModule(std::make_unique<Gain>());
+    EXPECT_TRUE(g.addConnection({inId, 2, gainId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({gainId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  }
+  EXPECT_LT(g.getPooledAudioMemory(), g.getUnpooledAudioMemory());
+
+  AudioBuffer buffer;
+  EventBuffer events;
+  for (int i = 0; i < 4; ++i)
+  {
+    buffer.resize(numSamples, 3);
+    buffer.zero();
+    buffer.fill(2, 0.5f);
+    g.process(buffer, events);
+    EXPECT_TRUE(samplesEqual(buffer.getChannelPointer(0)[0], 0.5f));
+  }
+  EXPECT_EQ(checker->numProcessed, 4);
+  EXPECT_EQ(checker->numWrongFlags, 0);
+}
+
+namespace
+{
+// passes audio through, and counts how many times it's been processed
+class ProcessCounter : public Module
+{
+public:
+  explicit ProcessCounter(size_t tailLength)
+  {
+    setNumIo(Audio | Input | Output, 1);
+    setNumIo(Event | Input, 1);
+    setTailLength(tailLength);
+  }
+
+  size_t numProcessed = 0;
+
+protected:
+  void process(ModuleProcessContext& context) override
+  {
+    ++numProcessed;
+    context.audioBuffer.getChannelPointer(0);
+  }
+};
+}
+
+TEST(Graph, Sleeping)
+{
+  const size_t numSamples = 64;
+
+  Graph g;
+  ProcessCounter* counter = nullptr;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(numSamples);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, 1);
+    g.setNumIo(Event | Input, 1);
+
+    const auto id = g.addModule(std::make_unique<ProcessCounter>(2 * numSamples));
+    counter = dynamic_cast<ProcessCounter*>(g.getModuleById(id));
+    ASSERT_NE(counter, nullptr);
+    EXPECT_EQ(counter->getTailLength(), 2 * numSamples);
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, id, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, id, 0, Connection::Type::Event}));
+    EXPECT_TRUE(g.addConnection({id, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  }
+
+  AudioBuffer buffer(numSamples, 1);
+  EventBuffer events;
+  events.setNumChannels(1);
+
+  buffer.fill(0.5f);
+  g.process(buffer, events);
+  EXPECT_EQ(counter->numProcessed, 1);
+  EXPECT_FALSE(buffer.isSilent());
+
+  // keeps going through its tail, then sleeps
+  for (int i = 0; i < 10; ++i)
+  {
+    buffer.zero();
+    g.process(buffer, events);
+  }
+  EXPECT_EQ(counter->numProcessed, 3);
+  EXPECT_TRUE(buffer.isSilent());
+
+  // an event wakes it up
+  EventMessage msg(EventMessage::Trigger, 0);
+  events.insert(msg, 0);
+  buffer.zero();
+  g.process(buffer, events);
+  EXPECT_EQ(counter->numProcessed, 4);
+
+  // and so does sound
+  events.clear();
+  for (int i = 0; i < 3; ++i)
+  {
+    buffer.zero();
+    g.process(buffer, events);
+  }
+  EXPECT_EQ(counter->numProcessed, 6);
+  buffer.fill(0.5f);
+  g.process(buffer, events);
+  EXPECT_EQ(counter->numProcessed, 7);
+  EXPECT_TRUE(samplesEqual(buffer.getChannelPointer(0)[numSamples - 1], 0.5f));
+}
+
+TEST(Graph, DeadBranches)
+{
+  const size_t numSamples = 64;
+
+  Graph g;
+  std::vector<ProcessCounter*> counters;
+  std::vector<size_t> ids;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(numSamples);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, 1);
+
+    // a -> b goes nowhere, c -> meter has a side effect
+    for (size_t i = 0; i < 3; ++i)
+    {
+      ids.push_back(g.addModule(std::make_unique<ProcessCounter>(MODULE_INFINITE_TAIL)));
+      counters.push_back(dynamic_cast<ProcessCounter*>(g.getModuleById(ids.back())));
+      ASSERT_NE(counters.back(), nullptr);
+    }
+    const auto lmId = g.addModule(std::make_unique<LevelMeter>());
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, ids[0], 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({ids[0], 0, ids[1], 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, ids[2], 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({ids[2], 0, lmId, 0, Connection::Type::Audio}));
+  }
+
+  AudioBuffer buffer(numSamples, 1);
+  EventBuffer events;
+  buffer.fill(0.5f);
+  g.process(buffer, events);
+  EXPECT_EQ(counters[0]->numProcessed, 0);
+  EXPECT_EQ(counters[1]->numProcessed, 0);
+  EXPECT_EQ(counters[2]->numProcessed, 1);
+
+  // connecting the end of the chain to the output brings the whole chain to life
+  EXPECT_TRUE(g.addConnection({ids[1], 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  buffer.fill(0.5f);
+  g.process(buffer, events);
+  EXPECT_EQ(counters[0]->numProcessed, 1);
+  EXPECT_EQ(counters[1]->numProcessed, 1);
+  EXPECT_TRUE(samplesEqual(buffer.getChannelPointer(0)[0], 0.5f));
+
+  // and cutting it out of the middle kills the start of it
+  g.removeConnection({ids[0], 0, ids[1], 0, Connection::Type::Audio});
+  g.process(buffer, events);
+  EXPECT_EQ(counters[0]->numProcessed, 1);
+  EXPECT_EQ(counters[1]->numProcessed, 2);
+  EXPECT_EQ(counters[2]->numProcessed, 3);
+}
+
+TEST(Graph, OrderIndependentOfInsertion)
+{
+  const size_t numSamples = 64;
+  const size_t numModules = 50;
+
+  Graph g;
+  g.setBlockSize(numSamples);
+  g.setSampleRate(44100);
+  g.setNumIo(Audio | Input | Output, 1);
+
+  std::vector<size_t> ids;
+  for (size_t i = 0; i < numModules; ++i)
+  {
+    ids.push_back(g.addModule(std::make_unique<Gain>()));
+  }
+
+  // chain the modules together in the reverse order they were added, adding connections in a jumbled order
+  std::vector<Connection> connections;
+  connections.push_back({g.getInputModule()->getId(), 0, ids.back(), 0, Connection::Type::Audio});
+  for (size_t i = numModules - 1; i > 0; --i)
+  {
+    connections.push_back({ids[i], 0, ids[i - 1], 0, Connection::Type::Audio});
+  }
+  connections.push_back({ids.front(), 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio});
+  for (size_t i = 0; i < connections.size(); i += 2)
+  {
+    EXPECT_TRUE(g.addConnection(connections[i]));
+  }
+  for (size_t i = 1; i < connections.size(); i += 2)
+  {
+    EXPECT_TRUE(g.addConnection(connections[i]));
+  }
+
+  // closing the loop isn't allowed
+  EXPECT_FALSE(g.addConnection({ids.front(), 0, ids.back(), 0, Connection::Type::Audio}));
+
+  // if anything ran before its input, the output would lag behind by a block
+  AudioBuffer expected(numSamples, 1);
+  expected.fill(0.5f);
+  AudioBuffer buffer;
+  EventBuffer events;
+  buffer.copyFrom(expected, true);
+  g.process(buffer, events);
+  EXPECT_TRUE(buffersEqual(buffer, expected));
+}
+
+TEST(Graph, BatchedEdit)
+{
+  const size_t numSamples = 128;
+  const size_t numIo = 2;
+  const size_t numModules = 300;
+
+  Graph g;
+  g.setBlockSize(numSamples);
+  g.setSampleRate(44100);
+
+  AudioBuffer input(numSamples, numIo);
+  input.fill(0.25f);
+  AudioBuffer silence(numSamples, numIo);
+  silence.zero();
+  AudioBuffer buffer;
+  EventBuffer events;
+
+  {
+    ScopedEdit edit(g);
+    EXPECT_TRUE(g.isEditing());
+
+    g.setNumIo(Audio | Input | Output, numIo);
+
+    size_t prevId = g.getInputModule()->getId();
+    for (size_t i = 0; i < numModules; ++i)
+    {
+      const auto id = g.addModule(std::make_unique<Gain>());
+      auto* gain = g.getModuleById(id);
+      ASSERT_NE(gain, nullptr);
+      EXPECT_TRUE(gain->isEditing());
+      gain->setNumIo(Audio | Input | Output, numIo);
+      for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+      {
+        EXPECT_TRUE(g.addConnection({prevId, cIdx, id, cIdx, Connection::Type::Audio}));
+      }
+      prevId = id;
+    }
+
+    // nested edits don't apply anything until the outermost one is done
+    g.beginEdit();
+    for (size_t cIdx = 0; cIdx < numIo; ++cIdx)
+    {
+      EXPECT_TRUE(g.addConnection({prevId, cIdx, g.getOutputModule()->getId(), cIdx, Connection::Type::Audio}));
+    }
+    g.commitEdit();
+    EXPECT_TRUE(g.isEditing());
+
+    // the audio thread still sees the graph as it was before the edit
+    buffer.copyFrom(input, true);
+    g.process(buffer, events);
+    EXPECT_TRUE(buffersEqual(buffer, silence));
+  }
+
+  EXPECT_FALSE(g.isEditing());
+  EXPECT_EQ(g.getNumModules(), numModules);
+
+  buffer.copyFrom(input, true);
+  g.process(buffer, events);
+  EXPECT_TRUE(buffersEqual(buffer, input));
+
+  // edits to a module on its own still work once the graph is done editing
+  auto* gain = g.getModuleAt(0);
+  {
+    ScopedEdit edit(*gain);
+    gain->setNumIo(Audio | Input | Output, 1);
+    gain->setNumIo(Audio | Input | Output, numIo);
+  }
+  EXPECT_FALSE(gain->isEditing());
+  buffer.copyFrom(input, true);
+  g.process(buffer, events);
+  EXPECT_TRUE(buffersEqual(buffer, input));
+
+  g.clear();
+  EXPECT_EQ(g.getNumModules(), 0);
+}
+
+TEST(Graph, ConcurrentEdits)
+{
+  const size_t numSamples = 64;
+  const size_t numIo = 2;
+
+  Graph g;
+  g.setBlockSize(numSamples);
+  g.setSampleRate(44100);
+  makeBasicGraph(g, numIo);
+
+  AudioBuffer input(numSamples, numIo);
+  input.fill(0.5f);
+
+  std::atomic<bool> done{false};
+  size_t numBlocks = 0;
+
+  std::thread procThread([&]()
+                         {
+                           AudioBuffer buffer;
+                           EventBuffer events;
+                           while (!done.load())
+                           {
+                             buffer.copyFrom(input, true);
+                             g.process(buffer, events);
+                             ++numBlocks;
+                           }
+                         });
+
+  // hammer the graph with every kind of edit while it's being processed
+  std::mt19937 rng(42);
+  std::vector<size_t> ids;
+  auto* aIn = g.getInputModule();
+  auto* aOut = g.getOutputModule();
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    switch (rng() % 6)
+    {
+      case 0:
+      case 1:
+      {
+        const auto id = g.addModule(std::make_unique<Gain>());
+        g.getModuleById(id)->setNumIo(Audio | Input | Output, numIo);
+        g.addConnection({aIn->getId(), rng() % numIo, id, rng() % numIo, Connection::Type::Audio});
+        if (!ids.empty())
+        {
+          g.addConnection({ids[rng() % ids.size()], 0, id, 1, Connection::Type::Audio});
+        }
+        g.addConnection({id, rng() % numIo, aOut->getId(), rng() % numIo, Connection::Type::Audio});
+        ids.push_back(id);
+        break;
+      }
+      case 2:
+        if (!ids.empty())
+        {
+          const size_t idx = rng() % ids.size();
+          EXPECT_TRUE(g.removeModuleById(ids[idx]));
+          ids.erase(ids.begin() + idx);
+        }
+        break;
+      case 3:
+        if (!ids.empty())
+        {
+          g.disconnectModule(ids[rng() % ids.size()]);
+        }
+        break;
+      case 4:
+        if (!ids.empty())
+        {
+          auto* m = g.getModuleById(ids[rng() % ids.size()]);
+          m->setNumIo(Audio | Input | Output, 1 + rng() % 4);
+        }
+        break;
+      case 5:
+      {
+        ScopedEdit edit(g);
+        for (size_t j = 0; j < 4 && !ids.empty(); ++j)
+        {
+          const size_t idx = rng() % ids.size();
+          g.removeModuleById(ids[idx]);
+          ids.erase(ids.begin() + idx);
+        }
+        break;
+      }
+      default:;
+    }
+  }
+
+  g.clear();
+  done.store(true);
+  procThread.join();
+
+  EXPECT_GT(numBlocks, 0);
+  EXPECT_EQ(g.getNumModules(), 0);
+
+  // once the audio thread is done, everything it might have been using can go
+  g.collectRetired();
+}
+
+namespace
+{
+// writes its param's smoothed values to its output
+class ParamWriter : public Module
+{
+public:
+  ParamWriter()
+  {
+    setNumIo(Audio | Output, 1);
+    addParam("value", "Value", ParamRange(0.0f, 1.0f, 0.0f));
+  }
+
+protected:
+  void process(ModuleProcessContext& context) override
+  {
+    updateParams(context);
+    memcpy(context.audioBuffer.getChannelPointer(0), getSmoothedParam(context, 0), context.blockSize * sizeof(float));
+  }
+};
+}
+
+TEST(Graph, ParamChanges)
+{
+  const size_t blockSize = 64;
+  Graph g;
+  size_t id = 0;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(blockSize);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Output, 1);
+    id = g.addModule(std::make_unique<ParamWriter>());
+    EXPECT_TRUE(g.addConnection({id, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  }
+
+  AudioBuffer audio(blockSize, 1);
+  EventBuffer events;
+  EXPECT_EQ(g.getSampleTime(), 0);
+
+  // posted out of order, from a couple of blocks ahead, with some that go nowhere
+  EXPECT_TRUE(g.postParamChange(id, 0, 0.5f, 2 * blockSize + 48));
+  EXPECT_TRUE(g.postParamChange(id, 0, 1.0f, 2 * blockSize + 16));
+  EXPECT_TRUE(g.postParamChange(id, 1, 1.0f, blockSize));
+  EXPECT_TRUE(g.postParamChange(id + 1, 0, 1.0f, blockSize));
+
+  for (int i = 0; i < 2; ++i)
+  {
+    g.process(audio, events);
+    EXPECT_EQ(audio.getChannelPointer(0)[blockSize - 1], 0.0f);
+  }
+  EXPECT_EQ(g.getSampleTime(), 2 * blockSize);
+
+  // each one lands on its own sample, and nothing moves before the first one
+  g.process(audio, events);
+  const float* out = audio.getChannelPointer(0);
+  for (size_t sIdx = 0; sIdx < 16; ++sIdx)
+  {
+    EXPECT_EQ(out[sIdx], 0.0f) << sIdx;
+  }
+  EXPECT_FLOAT_EQ(out[16], 1.0f);
+  EXPECT_FLOAT_EQ(out[47], 1.0f);
+  EXPECT_FLOAT_EQ(out[48], 0.5f);
+  EXPECT_FLOAT_EQ(out[blockSize - 1], 0.5f);
+  EXPECT_EQ(g.getModuleById(id)->getParam(0)->getRaw(), 0.5f);
+
+  // a change that's late lands at the start of the next block
+  EXPECT_TRUE(g.postParamChange(id, 0, 0.25f, 0));
+  g.process(audio, events);
+  EXPECT_FLOAT_EQ(audio.getChannelPointer(0)[0], 0.25f);
+  EXPECT_FLOAT_EQ(audio.getChannelPointer(0)[blockSize - 1], 0.25f);
+}
+
+TEST(Graph, ParamChangesBlockSizes)
+{
+  // the same changes come out the same whatever the block size
+  const size_t numSamples = 256;
+  std::vector<float> expected;
+
+  for (size_t blockSize : {16, 64, 256})
+  {
+    Graph g;
+    size_t id = 0;
+    {
+      ScopedEdit edit(g);
+      g.setBlockSize(blockSize);
+      g.setSampleRate(44100);
+      g.setNumIo(Audio | Output, 1);
+      id = g.addModule(std::make_unique<ParamWriter>());
+      EXPECT_TRUE(g.addConnection({id, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+    }
+
+    EXPECT_TRUE(g.postParamChange(id, 0, 0.25f, 5));
+    EXPECT_TRUE(g.postParamChange(id, 0, 1.0f, 70));
+    EXPECT_TRUE(g.postParamChange(id, 0, 0.5f, 128));
+    EXPECT_TRUE(g.postParamChange(id, 0, 0.75f, 200));
+
+    AudioBuffer audio(blockSize, 1);
+    EventBuffer events;
+    std::vector<float> out;
+    for (size_t start = 0; start < numSamples; start += blockSize)
+    {
+      g.process(audio, events);
+      const float* cPtr = audio.getChannelPointer(0);
+      out.insert(out.end(), cPtr, cPtr + blockSize);
+    }
+
+    if (expected.empty())
+    {
+      expected = out;
+      EXPECT_EQ(expected[4], 0.0f);
+      EXPECT_FLOAT_EQ(expected[5], 0.25f);
+      EXPECT_FLOAT_EQ(expected[69], 0.25f);
+      EXPECT_FLOAT_EQ(expected[70], 1.0f);
+      EXPECT_FLOAT_EQ(expected[128], 0.5f);
+      EXPECT_FLOAT_EQ(expected[255], 0.75f);
+    }
+    for (size_t sIdx = 0; sIdx < numSamples; ++sIdx)
+    {
+      ASSERT_EQ(out[sIdx], expected[sIdx]) << "block size " << blockSize << ", sample " << sIdx;
+    }
+  }
+}
+
+TEST(Graph, ParamChangesAfterClear)
+{
+  const size_t blockSize = 64;
+  Graph g;
+  AudioBuffer audio(blockSize, 1);
+  EventBuffer events;
+  auto addGain = [&]()
+  {
+    ScopedEdit edit(g);
+    const auto id = g.addModule(std::make_unique<Gain>());
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, id, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({id, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+    return id;
+  };
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(blockSize);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, 1);
+  }
+  const auto oldId = addGain();
+
+  // one change waiting in the graph for a later block, and one still in the queue
+  EXPECT_TRUE(g.postParamChange(oldId, 0, -40.0f, g.getSampleTime() + 2 * blockSize));
+  audio.fill(0.5f);
+  g.process(audio, events);
+  EXPECT_TRUE(g.postParamChange(oldId, 0, -40.0f, g.getSampleTime()));
+
+  g.clear();
+  EXPECT_NE(addGain(), oldId);
+
+  // neither lands on the new gain
+  for (int block = 0; block < 4; ++block)
+  {
+    audio.fill(0.5f);
+    g.process(audio, events);
+    for (size_t sIdx = 0; sIdx < blockSize; ++sIdx)
+    {
+      ASSERT_FLOAT_EQ(audio.getChannelPointer(0)[sIdx], 0.5f) << block << ", " << sIdx;
+    }
+  }
+}
+
+TEST(Graph, ParamChangesWhileSkipped)
+{
+  const size_t blockSize = 64;
+  Graph g;
+  size_t sleeperId = 0;
+  size_t deadId = 0;
+  {
+    ScopedEdit edit(g);
+    g.setBlockSize(blockSize);
+    g.setSampleRate(44100);
+    g.setNumIo(Audio | Input | Output, 1);
+    sleeperId = g.addModule(std::make_unique<Gain>());
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, sleeperId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({sleeperId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+    // not connected to anything yet, so it's left out
+    deadId = g.addModule(std::make_unique<Gain>());
+  }
+
+  AudioBuffer audio(blockSize, 1);
+  EventBuffer events;
+  audio.zero();
+  g.process(audio, events);
+
+  // more changes than a block has room for, while one gain sleeps through silence and the other isn't processed
+  for (int block = 0; block < 4; ++block)
+  {
+    const uint64_t blockStart = g.getSampleTime();
+    for (size_t i = 0; i < ModuleParam::MAX_CONTROL_POINTS; ++i)
+    {
+      const float db = (i % 2) ? -40.0f : 0.0f;
+      EXPECT_TRUE(g.postParamChange(sleeperId, 0, db, blockStart + i));
+      EXPECT_TRUE(g.postParamChange(deadId, 0, db, blockStart + i));
+    }
+    audio.zero();
+    g.process(audio, events);
+    EXPECT_TRUE(audio.isSilent());
+  }
+  EXPECT_TRUE(g.postParamChange(sleeperId, 0, -6.0f, g.getSampleTime() - 1));
+  EXPECT_TRUE(g.postParamChange(deadId, 0, -6.0f, g.getSampleTime() - 1));
+  audio.zero();
+  g.process(audio, events);
+
+  // when they're processed again, they start from the last change, with nothing left over from before
+  const float expected = 0.5f * std::pow(10.0f, -6.0f / 20.0f);
+  audio.fill(0.5f);
+  g.process(audio, events);
+  for (size_t sIdx = 0; sIdx < blockSize; ++sIdx)
+  {
+    ASSERT_NEAR(audio.getChannelPointer(0)[sIdx], expected, 1e-4f) << sIdx;
+  }
+
+  {
+    ScopedEdit edit(g);
+    g.disconnectModule(sleeperId);
+    EXPECT_TRUE(g.addConnection({g.getInputModule()->getId(), 0, deadId, 0, Connection::Type::Audio}));
+    EXPECT_TRUE(g.addConnection({deadId, 0, g.getOutputModule()->getId(), 0, Connection::Type::Audio}));
+  }
+  audio.fill(0.5f);
+  g.process(audio, events);
+  for (size_t sIdx = 0; sIdx < blockSize; ++sIdx)
+  {
+    ASSERT_NEAR(audio.getChannelPointer(0)[sIdx], expected, 1e-4f) << sIdx;
+  }
+}